@@ -0,0 +1,846 @@
+/*
+ * benchSymbol.c - benchmarks for the functions of symbol.h
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "symbol.h"
+
+/** @file benchSymbol.c
+ *  @brief Benchmarks for the symbol table
+ *
+ *  @details Each benchmark is a function that builds its own tables and
+ *  prints one line per measurement, reporting the average time of one
+ *  operation in nanoseconds. Build with <code>make bench</code> (which
+ *  compiles with optimization and without debug output) and run
+ *  <code>./benchSymbol</code> with no arguments for usage.
+ *  <p>
+ *  With <code>-counters</code>, each timed batch of operations is also
+ *  measured with the hardware performance counters of
+ *  <code>perf_event_open()</code>, and a line of counts per operation is
+ *  printed under each row: cycles, instructions, L1 data cache and last
+ *  level cache misses, branch mispredictions and data TLB misses. Counts
+ *  are of user space only and include threads the benchmark starts. Any
+ *  counter the machine or kernel does not provide (see
+ *  <code>/proc/sys/kernel/perf_event_paranoid</code>) is reported once and
+ *  left out, and without any counters the benchmarks run as usual.
+ */
+
+/** Longest name generated by the benchmarks */
+#define MAX_NAME 64
+
+/** Rounds of churn run before <code>bench_churn()</code> reports any */
+#define CHURN_WARMUP 4
+
+/** Number of hardware counters read around each batch */
+#define NUM_COUNTERS 6
+
+/** Longest line of counts printed for one batch */
+#define MAX_REPORT 256
+
+/** Most batches measured before their counts are printed */
+#define MAX_BATCHES 8
+
+/** Defines a hardware counter: how to print it and how to open it */
+typedef struct counter {
+  const char* name;       /**< label in the report            */
+  unsigned    type;       /**< perf_event_attr type           */
+  uint64_t    config;     /**< perf_event_attr config         */
+  int         fd;         /**< open counter, or -1            */
+} counter_t;
+
+/** Defines a benchmark: a name to select it and a function to run it */
+typedef struct bench {
+  const char* name;               /**< command line name of the benchmark */
+  void      (*run) (int size);    /**< runs it with a table of size size  */
+  const char* help;               /**< one line description               */
+} bench_t;
+
+/** State of the xorshift random number generator, seeded so that every run
+ *  performs the same operations.
+ */
+static unsigned long long rng = 88172645463325252ULL;
+
+/** Return a pseudo random number */
+static unsigned rand32 (void) {
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return (unsigned) rng;
+}
+
+#ifdef __linux__
+/** Encode a cache event for perf_event_attr config */
+#define CACHE_EVENT(cache, op, result) \
+  ((cache) | ((op) << 8) | ((result) << 16))
+
+/** The counters read around each batch */
+static counter_t counters[NUM_COUNTERS] = {
+  { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1 },
+  { "instr", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, -1 },
+  { "L1d-miss", PERF_TYPE_HW_CACHE,
+    CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                PERF_COUNT_HW_CACHE_RESULT_MISS), -1 },
+  { "LLC-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, -1 },
+  { "br-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, -1 },
+  { "dTLB-miss", PERF_TYPE_HW_CACHE,
+    CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+                PERF_COUNT_HW_CACHE_RESULT_MISS), -1 },
+};
+#else
+static counter_t counters[NUM_COUNTERS] = {
+  { "cycles", 0, 0, -1 }, { "instr", 0, 0, -1 }, { "L1d-miss", 0, 0, -1 },
+  { "LLC-miss", 0, 0, -1 }, { "br-miss", 0, 0, -1 }, { "dTLB-miss", 0, 0, -1 },
+};
+#endif
+
+/** Are any counters open? */
+static int counting = 0;
+
+/** Counts of the batches measured since the last row was printed */
+static char reports[MAX_BATCHES][MAX_REPORT];
+
+/** Number of lines in <code>reports</code> */
+static int nreports = 0;
+
+/** Open every counter the system provides, reporting the others, and
+ *  return the number opened.
+ */
+static int counters_open (void) {
+  for (int c = 0; c < NUM_COUNTERS; c++) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = counters[c].type;
+    attr.config         = counters[c].config;
+    attr.disabled       = 1;
+    attr.inherit        = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    counters[c].fd = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    errno = ENOSYS;
+#endif
+
+    if (counters[c].fd < 0)
+      printf("counter %s unavailable: %s\n", counters[c].name, strerror(errno));
+    else
+      counting++;
+  }
+
+  return counting;
+}
+
+/** Start counting a batch of operations */
+static void counters_begin (void) {
+#ifdef __linux__
+  for (int c = 0; c < NUM_COUNTERS; c++) {
+    if (counters[c].fd >= 0) {
+      ioctl(counters[c].fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(counters[c].fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#endif
+}
+
+/** Stop counting a batch of <code>ops</code> operations and keep its counts
+ *  per operation, to be printed by <code>counters_report()</code>.
+ */
+static void counters_end (const char* what, int ops) {
+  char* line = reports[nreports];
+  int   len;
+
+  if (! counting || nreports == MAX_BATCHES)
+    return;
+
+  len = snprintf(line, MAX_REPORT, "  %-8s", what);
+
+  for (int c = 0; c < NUM_COUNTERS; c++) {
+    uint64_t value[3];    /* count, time enabled, time running */
+
+    if (counters[c].fd < 0)
+      continue;
+
+    ioctl(counters[c].fd, PERF_EVENT_IOC_DISABLE, 0);
+
+    if (read(counters[c].fd, value, sizeof(value)) != sizeof(value) || value[2] == 0) {
+      len += snprintf(line + len, MAX_REPORT - len, " %s -", counters[c].name);
+      continue;
+    }
+
+    //scale up counts the kernel multiplexed with other counters
+    double count = (double) value[0] * value[1] / value[2];
+    len += snprintf(line + len, MAX_REPORT - len, " %s %.1f", counters[c].name, count / ops);
+
+    if (len >= MAX_REPORT)
+      len = MAX_REPORT - 1;
+  }
+
+  nreports++;
+}
+
+/** Print the counts of the batches measured since the last call */
+static void counters_report (void) {
+  for (int i = 0; i < nreports; i++)
+    puts(reports[i]);
+
+  nreports = 0;
+}
+
+/** Return the current time in nanoseconds */
+static double now (void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/** Write the name of label number <code>id</code> into <code>buf</code> */
+static char* label (char* buf, int id) {
+  snprintf(buf, MAX_NAME, "L%d", id);
+  return buf;
+}
+
+/** Replace a random quarter of the symbols in each round, then look up as
+ *  many live symbols, chosen at random, and as many missing ones. The first
+ *  rounds are not reported: they turn the insertion ordered layout of the
+ *  full table into the scattered one churn leaves, which the reported rounds
+ *  then measure. Remove, add and lookup times should stay flat from round to
+ *  round.
+ */
+static void bench_churn (int size) {
+  sym_table_t* symTab = symbol_init(size);
+  int*         live   = malloc(size * sizeof(int));
+  int*         slots  = malloc(size * sizeof(int));
+  int          nextId = 0;
+  int          batch  = size / 4;
+  char         name[MAX_NAME];
+  volatile int found  = 0;
+
+  for (int i = 0; i < size; i++) {
+    slots[i] = i;
+    live[i]  = nextId++;
+    symbol_add(symTab, label(name, live[i]), i & 0xFFFF);
+  }
+
+  printf("%-6s %12s %12s %12s %12s\n", "round", "remove ns", "add ns", "hit ns", "miss ns");
+
+  for (int round = -CHURN_WARMUP; round < 20; round++) {
+    //choose batch distinct slots with a partial Fisher-Yates shuffle
+    for (int i = 0; i < batch; i++) {
+      int j    = i + rand32() % (size - i);
+      int tmp  = slots[i];
+      slots[i] = slots[j];
+      slots[j] = tmp;
+    }
+
+    counters_begin();
+    double t0 = now();
+
+    for (int i = 0; i < batch; i++)
+      symbol_remove(symTab, label(name, live[slots[i]]));
+
+    double t1 = now();
+    counters_end("remove", batch);
+    counters_begin();
+
+    for (int i = 0; i < batch; i++) {
+      live[slots[i]] = nextId++;
+      symbol_add(symTab, label(name, live[slots[i]]), slots[i] & 0xFFFF);
+    }
+
+    double t2 = now();
+    counters_end("add", batch);
+    counters_begin();
+
+    for (int i = 0; i < size; i++)
+      found += (symbol_find_by_name(symTab, label(name, live[rand32() % size])) != NULL);
+
+    double t3 = now();
+    counters_end("hit", size);
+    counters_begin();
+
+    for (int i = 0; i < size; i++)
+      found += (symbol_find_by_name(symTab, label(name, nextId + i)) != NULL);
+
+    double t4 = now();
+    counters_end("miss", size);
+
+    if (round < 0) {
+      nreports = 0;     //drop the counts of the warm-up rounds
+      continue;
+    }
+
+    printf("%-6d %12.1f %12.1f %12.1f %12.1f\n", round,
+           (t1 - t0) / batch, (t2 - t1) / batch, (t3 - t2) / size, (t4 - t3) / size);
+    counters_report();
+  }
+
+  free(slots);
+  free(live);
+  symbol_term(symTab);
+}
+
+/** Count the duplicates reported by symbol_merge() */
+static void countConflict (symbol_t* existing, symbol_t* duplicate, int src, void* data) {
+  (*(int*) data)++;
+}
+
+/** Count the symbols of a table */
+static void countSymbol (symbol_t* sym, void* data) {
+  (*(int*) data)++;
+}
+
+/** What <code>checkMerged()</code> compares a merged table with */
+typedef struct merged {
+  sym_table_t*  dst;      /**< the table merged into              */
+  sym_table_t** srcs;     /**< the tables merged, in order        */
+  int           nsrcs;    /**< number of tables in srcs           */
+  int           errors;   /**< symbols merged wrongly or missing  */
+} merged_t;
+
+/** Check that a source symbol made it into the merged table with the address
+ *  of the first source that defines it
+ */
+static void checkMerged (symbol_t* sym, void* data) {
+  merged_t* m     = data;
+  symbol_t* got   = symbol_find_by_name(m->dst, sym->name);
+  symbol_t* first = symbol_find_in_tables(m->srcs, m->nsrcs, sym->name, NULL);
+
+  if (! got || got->addr != first->addr)
+    m->errors++;
+}
+
+/** Merge 64 module tables, each defining size / 64 symbols of which one in
+ *  eight is also defined by another module, with increasing thread counts.
+ *  Each merged table is checked against the sources: it must hold one symbol
+ *  per distinct name, with the address the first module gives it.
+ */
+static void bench_merge (int size) {
+  int          nsrcs = 64;
+  int          per   = size / nsrcs + 1;
+  int          total = 0;
+  sym_table_t* srcs[64];
+  char         name[MAX_NAME];
+
+  for (int s = 0; s < nsrcs; s++) {
+    srcs[s] = symbol_init(per);
+
+    for (int i = 0; i < per; i++) {
+      int id = (i % 8 == 0) ? (int) (rand32() % size) : s * per + i + size;
+      total += symbol_add(srcs[s], label(name, id), i);
+    }
+  }
+
+  printf("%-8s %12s %12s %12s\n", "threads", "ns/symbol", "duplicates", "errors");
+
+  for (int nthreads = 1; nthreads <= 16; nthreads *= 2) {
+    sym_table_t* dst  = symbol_init(size);
+    int          dups = 0, count = 0;
+    merged_t     m    = { dst, srcs, nsrcs, 0 };
+
+    counters_begin();
+    double t0 = now();
+
+    if (symbol_merge(dst, srcs, nsrcs, nthreads, countConflict, &dups) != dups)
+      m.errors++;
+
+    double t1 = now();
+    counters_end("merge", nsrcs * per);
+
+    for (int s = 0; s < nsrcs; s++)
+      symbol_iterate(srcs[s], checkMerged, &m);
+
+    symbol_iterate(dst, countSymbol, &count);
+
+    if (count != total - dups)
+      m.errors++;
+
+    printf("%-8d %12.1f %12d %12d\n", nthreads, (t1 - t0) / (nsrcs * per), dups, m.errors);
+    counters_report();
+    symbol_term(dst);
+  }
+
+  for (int s = 0; s < nsrcs; s++)
+    symbol_term(srcs[s]);
+}
+
+/** Resolve references against a chain of 64 module tables, each defining
+ *  size / 64 symbols, where nine references in ten are to symbols no module
+ *  defines. Compares the tables with and without Bloom filters, resolving
+ *  the same references each time, and counts the references resolved
+ *  differently from the tables without filters.
+ */
+static void bench_resolve (int size) {
+  int          ntabs = 64;
+  int          per   = size / ntabs + 1;
+  sym_table_t* tabs[64];
+  char         name[MAX_NAME];
+  int*         ids   = malloc(size * sizeof(int));
+  int*         where = malloc(size * sizeof(int));
+
+  for (int t = 0; t < ntabs; t++) {
+    tabs[t] = symbol_init(per);
+
+    for (int i = 0; i < per; i++)
+      symbol_add(tabs[t], label(name, t * per + i), i);
+  }
+
+  for (int i = 0; i < size; i++)
+    ids[i] = rand32() % (10 * ntabs * per);
+
+  printf("%-8s %12s %12s\n", "bits", "ns/lookup", "errors");
+
+  for (int bits = 0; bits <= 16; bits += 8) {
+    int errors = 0;
+
+    for (int t = 0; t < ntabs; t++)
+      symbol_bloom(tabs[t], bits);
+
+    counters_begin();
+    double t0 = now();
+
+    for (int i = 0; i < size; i++) {
+      int which = -1;
+
+      symbol_find_in_tables(tabs, ntabs, label(name, ids[i]), &which);
+
+      if (bits == 0)
+        where[i] = which;
+      else
+        errors += (which != where[i]);
+    }
+
+    double t1 = now();
+    counters_end("lookup", size);
+    printf("%-8d %12.1f %12d\n", bits, (t1 - t0) / size, errors);
+    counters_report();
+  }
+
+  free(where);
+  free(ids);
+
+  for (int t = 0; t < ntabs; t++)
+    symbol_term(tabs[t]);
+}
+
+/** Fill tables of increasing size, up to <code>size</code> symbols, reset
+ *  each several times, and report the average time of one reset along with
+ *  the time per symbol to fill the table again afterwards (which includes
+ *  reclaiming the storage the reset left behind). Reset time should not grow
+ *  with the size of the table.
+ */
+static void bench_reset (int size) {
+  char name[MAX_NAME];
+
+  printf("%-10s %12s %12s\n", "symbols", "reset ns", "refill ns");
+
+  for (int n = size / 256 + 1; ; n *= 4) {
+    if (n > size)
+      n = size;
+
+    sym_table_t* symTab = symbol_init(n);
+    double       reset  = 0, refill = 0;
+    int          rounds = 8;
+
+    for (int i = 0; i < n; i++)
+      symbol_add(symTab, label(name, i), i & 0xFFFF);
+
+    for (int round = 0; round < rounds; round++) {
+      double t0 = now();
+
+      symbol_reset(symTab);
+
+      double t1 = now();
+
+      if (round == rounds - 1)
+        counters_begin();
+
+      for (int i = 0; i < n; i++)
+        symbol_add(symTab, label(name, i), i & 0xFFFF);
+
+      double t2 = now();
+      reset  += t1 - t0;
+      refill += t2 - t1;
+    }
+
+    counters_end("refill", n);
+    printf("%-10d %12.1f %12.1f\n", n, reset / rounds, refill / rounds / n);
+    counters_report();
+    symbol_term(symTab);
+
+    if (n == size)
+      break;
+  }
+}
+
+/** Look symbols up by address in a table of 16 bit addresses, which uses a
+ *  dense address table, and in one of 32 bit addresses spread over the whole
+ *  space, which uses an address hash table.
+ */
+static void bench_addr (int size) {
+  char name[MAX_NAME];
+
+  printf("%-8s %12s %12s\n", "bits", "add ns", "lookup ns");
+
+  for (int bits = 16; bits <= 32; bits += 16) {
+    sym_table_t* symTab = symbol_init_width(size, bits);
+    unsigned     mask   = (bits == 32) ? 0xFFFFFFFEu : 0xFFFFu;
+    unsigned*    addrs  = malloc(size * sizeof(unsigned));
+    volatile int found  = 0;
+
+    for (int i = 0; i < size; i++)
+      addrs[i] = rand32() & mask;
+
+    counters_begin();
+    double t0 = now();
+
+    for (int i = 0; i < size; i++)
+      symbol_add(symTab, label(name, i), (int) addrs[i]);
+
+    double t1 = now();
+    counters_end("add", size);
+    counters_begin();
+
+    for (int i = 0; i < size; i++)
+      found += (symbol_find_by_addr(symTab, (int) addrs[rand32() % size]) != NULL);
+
+    double t2 = now();
+    counters_end("lookup", size);
+    printf("%-8d %12.1f %12.1f\n", bits, (t1 - t0) / size, (t2 - t1) / size);
+    counters_report();
+    free(addrs);
+    symbol_term(symTab);
+  }
+}
+
+/** Write the name of the <code>id</code>th generated label into
+ *  <code>buf</code>: labels are numbered within 16 modules, and every name is
+ *  too long to be stored in a node.
+ */
+static char* long_label (char* buf, int id) {
+  snprintf(buf, MAX_NAME, "__module_%02d_codegen_basic_block_L%07d", id % 16, id / 16);
+  return buf;
+}
+
+/** Fill a table with generated labels that share long prefixes, first with
+ *  each name copied to the heap and then with compressed names, and report
+ *  the bytes per symbol the table holds (as counted by symbol_memory()) and
+ *  the time to find every symbol by name. A compressed name is decoded into
+ *  a copy of its own the first time it is found, so the bytes per symbol
+ *  are reported again once the lookups have found most of them.
+ */
+static void bench_names (int size) {
+  char name[MAX_NAME];
+
+  printf("%-10s %12s %12s %12s %12s\n", "names", "bytes/sym", "add ns", "find ns",
+         "after find");
+
+  for (int packed = 0; packed <= 1; packed++) {
+    sym_table_t* symTab = symbol_init(size);
+    symbol_mem_t mem, after;
+    volatile int found  = 0;
+
+    symbol_compress_names(symTab, packed);
+
+    //add the labels of one module after another, as a code generator would
+    counters_begin();
+    double t0 = now();
+
+    for (int m = 0; m < 16; m++) {
+      for (int i = m; i < size; i += 16)
+        symbol_add(symTab, long_label(name, i), i & 0xFFFF);
+    }
+
+    double t1 = now();
+    counters_end("add", size);
+    symbol_memory(symTab, &mem);
+    counters_begin();
+
+    for (int i = 0; i < size; i++)
+      found += (symbol_find_by_name(symTab, long_label(name, rand32() % size)) != NULL);
+
+    double t2 = now();
+    counters_end("find", size);
+    symbol_memory(symTab, &after);
+    printf("%-10s %12.1f %12.1f %12.1f %12.1f\n", packed ? "compressed" : "copied",
+           (double) mem.live / size, (t1 - t0) / size, (t2 - t1) / size,
+           (double) after.live / size);
+    counters_report();
+    symbol_term(symTab);
+  }
+}
+
+/** Churn long names through a table in shared memory the way
+ *  <code>bench_churn()</code> does, replacing a random quarter of the symbols
+ *  in each round and then looking up every live one. The table has room for
+ *  twice as many symbols as it ever holds, and every name is longer than the
+ *  32 characters it budgets for each, so it only keeps up if removing a
+ *  symbol gives back the space of its name. Adds that fail and live symbols
+ *  that are not found are reported together as failed, and should stay 0.
+ */
+static void bench_shm_churn (int size) {
+  char         path[MAX_NAME];
+  char         name[MAX_NAME];
+  int          nextId = 0;
+  int          batch  = size / 4;
+  int          failed = 0;
+  int          found;
+
+  snprintf(path, sizeof(path), "/benchSymbol.%ld", (long) getpid());
+
+  sym_table_t* symTab = symbol_shm_create(path, size, 2 * size);
+
+  if (! symTab) {
+    printf("cannot create shared memory object %s\n", path);
+    return;
+  }
+
+  symbol_shm_unlink(path);
+
+  int* live  = malloc(size * sizeof(int));
+  int* slots = malloc(size * sizeof(int));
+
+  for (int i = 0; i < size; i++) {
+    slots[i] = i;
+    live[i]  = nextId++;
+    failed  += (symbol_add(symTab, long_label(name, live[i]), i & 0xFFFF) != 1);
+  }
+
+  printf("%-6s %12s %12s %12s %12s\n", "round", "remove ns", "add ns", "hit ns", "failed");
+
+  for (int round = -CHURN_WARMUP; round < 20; round++) {
+    for (int i = 0; i < batch; i++) {
+      int j    = i + rand32() % (size - i);
+      int tmp  = slots[i];
+      slots[i] = slots[j];
+      slots[j] = tmp;
+    }
+
+    counters_begin();
+    double t0 = now();
+
+    for (int i = 0; i < batch; i++)
+      symbol_remove(symTab, long_label(name, live[slots[i]]));
+
+    double t1 = now();
+    counters_end("remove", batch);
+    counters_begin();
+
+    for (int i = 0; i < batch; i++) {
+      live[slots[i]] = nextId++;
+      failed += (symbol_add(symTab, long_label(name, live[slots[i]]), slots[i] & 0xFFFF) != 1);
+    }
+
+    double t2 = now();
+    counters_end("add", batch);
+    counters_begin();
+    found = 0;
+
+    for (int i = 0; i < size; i++)
+      found += (symbol_find_by_name(symTab, long_label(name, live[i])) != NULL);
+
+    double t3 = now();
+    counters_end("hit", size);
+
+    if (round < 0) {
+      nreports = 0;
+      continue;
+    }
+
+    printf("%-6d %12.1f %12.1f %12.1f %12d\n", round,
+           (t1 - t0) / batch, (t2 - t1) / batch, (t3 - t2) / size, failed + size - found);
+    counters_report();
+  }
+
+  free(slots);
+  free(live);
+  symbol_term(symTab);
+}
+
+/** Fill <code>ids</code> with <code>n</code> symbol numbers below
+ *  <code>size</code>, drawn from a Zipf distribution (the k-th most popular
+ *  symbol is looked up in proportion to 1/k) if <code>zipf</code> is set, or
+ *  uniformly otherwise. Popularity is unrelated to the order symbols are
+ *  added in.
+ */
+static void draw_ids (int* ids, int n, int size, int zipf) {
+  double* cdf  = malloc(size * sizeof(double));
+  int*    rank = malloc(size * sizeof(int));
+  double  sum  = 0;
+
+  for (int k = 0; k < size; k++) {
+    sum   += 1.0 / (k + 1);
+    cdf[k] = sum;
+    rank[k] = k;
+  }
+
+  for (int k = size - 1; k > 0; k--) {
+    int j = rand32() % (k + 1), t = rank[k];
+    rank[k] = rank[j];
+    rank[j] = t;
+  }
+
+  for (int i = 0; i < n; i++) {
+    if (! zipf) {
+      ids[i] = rand32() % size;
+      continue;
+    }
+
+    double u  = sum * rand32() / 4294967296.0;
+    int    lo = 0, hi = size - 1;
+
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+
+      if (cdf[mid] <= u)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+    ids[i] = rank[lo];
+  }
+
+  free(rank);
+  free(cdf);
+}
+
+/** Look symbols up by name with and without a hot symbol cache, for lookups
+ *  that follow a Zipf distribution and for uniform ones, in a table with one
+ *  symbol per hash table index and in one with eight. Each time is the best
+ *  of five rounds.
+ */
+static void bench_zipf (int size) {
+  char name[MAX_NAME];
+  int* ids = malloc(size * sizeof(int));
+
+  printf("%-6s %-8s %12s %12s\n", "load", "lookups", "plain ns", "cached ns");
+
+  for (int load = 1; load <= 8; load *= 8) {
+    sym_table_t* symTab = symbol_init(size / load);
+    volatile int found  = 0;
+
+    for (int i = 0; i < size; i++)
+      symbol_add(symTab, label(name, i), i & 0xFFFF);
+
+    for (int zipf = 1; zipf >= 0; zipf--) {
+      double ns[2] = { 1e18, 1e18 };
+
+      draw_ids(ids, size, size, zipf);
+
+      //alternate the two so that both see the same machine, and keep the best
+      for (int round = 0; round < 5; round++) {
+        for (int cached = 0; cached <= 1; cached++) {
+          symbol_hot_cache(symTab, cached ? 1024 : 0);
+
+          if (round == 4)
+            counters_begin();
+
+          double t0 = now();
+
+          for (int i = 0; i < size; i++)
+            found += (symbol_find_by_name(symTab, label(name, ids[i])) != NULL);
+
+          double t = (now() - t0) / size;
+
+          if (t < ns[cached])
+            ns[cached] = t;
+
+          if (round == 4)
+            counters_end(cached ? "cached" : "plain", size);
+        }
+      }
+
+      printf("%-6d %-8s %12.1f %12.1f\n", load, zipf ? "zipf" : "uniform", ns[0], ns[1]);
+      counters_report();
+    }
+
+    symbol_term(symTab);
+  }
+
+  free(ids);
+}
+
+/** The benchmarks that can be run */
+static const bench_t benches[] = {
+  { "churn", bench_churn, "insert/remove churn, lookup cost per round" },
+  { "addr", bench_addr, "lookups by 16 and 32 bit address" },
+  { "merge", bench_merge, "parallel merge of 64 module tables" },
+  { "resolve", bench_resolve, "lookups across 64 tables, with Bloom filters" },
+  { "names", bench_names, "memory and lookups with compressed names" },
+  { "shmchurn", bench_shm_churn, "insert/remove churn of long names in shared memory" },
+  { "reset", bench_reset, "reset latency as the table grows" },
+  { "zipf", bench_zipf, "skewed lookups by name, with a hot symbol cache" },
+};
+
+/** Number of benchmarks */
+#define NUM_BENCHES ((int) (sizeof(benches) / sizeof(benches[0])))
+
+/** Print a usage statement describing how program is used, and exits */
+static void usage (void) {
+  puts("Usage: benchSymbol [-counters] <benchmark|all> [size]\n");
+
+  for (int i = 0; i < NUM_BENCHES; i++)
+    printf("%-10s - %s\n", benches[i].name, benches[i].help);
+
+  exit(1);
+}
+
+/** Entry point of the program
+ * @param argc count of arguments
+ * @param argv an optional <code>-counters</code>, the benchmark to run and
+ *        the number of symbols to use
+ * @return 0 the Linux convention for success.
+ */
+int main (int argc, const char* argv[]) {
+  int size = 100000;
+  int ran  = 0;
+
+  if (argc > 1 && strcmp(argv[1], "-counters") == 0) {
+    if (counters_open() == 0)
+      puts("no hardware counters available, timing only");
+
+    argc--;
+    argv++;
+  }
+
+  if (argc < 2)
+    usage();
+
+  if (argc > 2)
+    size = atoi(argv[2]);
+
+  if (size < 4)
+    usage();
+
+  for (int i = 0; i < NUM_BENCHES; i++) {
+    if (strcmp(argv[1], "all") == 0 || strcmp(argv[1], benches[i].name) == 0) {
+      printf("== %s (%d symbols)\n", benches[i].name, size);
+      benches[i].run(size);
+      ran = 1;
+    }
+  }
+
+  if (! ran)
+    usage();
+
+  return 0;
+}
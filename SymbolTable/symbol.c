@@ -1,214 +1,3008 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <ctype.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Debug.h"
+#include "symbol.h"
+
+/** @file symbol.c
+ *  @brief You will modify this file and implement the symbol.h interface
+ *  @details Your implementation of the functions defined in symbol.h.
+ *  You may add other functions if you find it helpful. Added functions
+ *  should be declared <b>static</b> to indicate they are only used
+ *  within this file.
+ * <p>
+ * @author <b>Your name</b> goes here
+ */
+
+/** width of an LC3 address in bits */
+#define LC3_ADDR_BITS 16
+
+/** size of LC3 memory */
+#define LC3_MEMORY_SIZE  (1 << LC3_ADDR_BITS)
+
+/** Widest address space whose address table is a dense array. A wider one
+ *  gets a hash table of the addresses in use instead.
+ */
+#define ADDR_DENSE_BITS 16
+
+/** log2 of the initial number of slots of an address hash table */
+#define ADDR_HASH_BITS 10
+
+/** Index used to mark the end of a chain or an empty table slot */
+#define NIL (-1)
+
+/** log2 of the number of hash table entries in one page */
+#define BUCKET_SHIFT 10
+
+/** log2 of the number of nodes in one page */
+#define NODE_SHIFT 6
+
+/** log2 of the number of address table entries in one page */
+#define ADDR_SHIFT 10
+
+/** log2 of the number of Bloom filter blocks in one page */
+#define BLOOM_SHIFT 6
+
+/** Number of bits set in a Bloom filter block for each name */
+#define BLOOM_PROBES 6
+
+/** Bytes of name storage inside a node; shorter names are stored inline */
+#define NAME_INLINE 27
+
+/** Number of leading characters folded into a node's name prefix */
+#define NAME_PREFIX 8
+
+/** Value of a node's length byte when the name is too long to record */
+#define NAME_LONG 255
+
+/** log2 of the number of bytes in one page of a name store */
+#define NAMES_SHIFT 12
+
+/** Number of names in a block of a name store; the first name of each block
+ *  is stored whole, so decoding a name reads at most this many entries.
+ */
+#define NAMES_BLOCK 16
+
+/** Value of the last byte of a node's short name when its long name is in
+ *  the table's name store.
+ */
+#define NAME_PACKED 1
+
+/** Number of tables whose filters symbol_find_in_tables() tests at a time */
+#define FIND_BATCH 64
+
+/** Most slots a hot symbol cache may have */
+#define HOT_MAX_SLOTS (1 << 16)
+
+/** Bits of a hash value kept in a hot symbol cache slot */
+#define HOT_TAG_MASK 0x0FFFFFFF
+
+/** Position of the hit count in a hot symbol cache slot */
+#define HOT_HITS_SHIFT 60
+
+/** Hit count at which a hot symbol cache slot stops counting */
+#define HOT_MAX_HITS 3
+
+/** Score of a new hot symbol cache, and the score above which it earns no more */
+#define HOT_SCORE_START 64
+#define HOT_SCORE_MAX   256
+
+/** Score a hot symbol cache gains for a hit; each miss costs it one */
+#define HOT_HIT_CREDIT 8
+
+/** A hot symbol cache out of credit is probed by one lookup in this many */
+#define HOT_SAMPLE 64
+
+/** Identifies a region created by <code>symbol_shm_create()</code> */
+#define SHM_MAGIC 0x53594D33
+
+/** Number of paged arrays kept in a shared region */
+#define SHM_ARRAYS 5
+
+/** Bytes of long name storage a shared region reserves per symbol: a name
+ *  of 32 characters, rounded up to SHM_NAME_GRAIN
+ */
+#define SHM_NAME_BYTES 40
+
+/** A long name in a shared region takes a multiple of this many bytes */
+#define SHM_NAME_GRAIN 8
+
+/** Largest block of long name storage with a free list of its own size */
+#define SHM_NAME_SMALL 256
+
+/** Number of free lists of long name blocks in a shared region: one for
+ *  each multiple of SHM_NAME_GRAIN up to SHM_NAME_SMALL, and one for all
+ *  larger blocks
+ */
+#define SHM_NAME_LISTS (SHM_NAME_SMALL / SHM_NAME_GRAIN + 1)
+
+/** Defines the data structure used to store nodes in the hash table. Nodes
+ *  are numbered and refer to each other by number rather than by pointer, so
+ *  a page of nodes can be copied without patching the chains that run
+ *  through it. The hash table and address table hold node numbers, and so
+ *  does the array of symbols in insertion order that iteration scans. The
+ *  node of a removed symbol has hash NIL, which no name hashes to; it is
+ *  kept on a free list and reused by the next symbol added.
+ *  <p>
+ *  A node fills exactly one cache line. Names shorter than
+ *  <code>NAME_INLINE</code> are stored in the node itself, and the length and
+ *  lower case prefix let <code>node_find()</code> reject most candidates
+ *  without reading the name at all.
+ */
+typedef struct node {
+  _Alignas(64)
+  symbol_t      symbol;   /**< the data the user is interested in       */
+  uint64_t      prefix;   /**< first characters of name, lower case     */
+  int           next;     /**< node number of next symbol at same index */
+  int           hash;     /**< hash value - makes searching faster      */
+  int           addr_next;/**< node number of next symbol at same addr  */
+  unsigned char len;      /**< length of name, at most NAME_LONG        */
+  char          short_name[NAME_INLINE]; /**< name, if it fits        */
+} node_t;
+
+_Static_assert(sizeof(node_t) == 64, "a node should fill one cache line");
+
+/** The allocator and memory accounts of a table. A snapshot shares them
+ *  with its parent, since either may end up freeing what the other
+ *  allocated.
+ */
+typedef struct mem {
+  symbol_alloc_t alloc;   /**< where the memory comes from            */
+  size_t         budget;  /**< most bytes live at once, 0 if no limit */
+  _Atomic size_t live;    /**< bytes allocated and not yet freed      */
+  _Atomic size_t peak;    /**< most bytes ever live at once           */
+  _Atomic int    refs;    /**< tables using these accounts            */
+} mem_t;
+
+/** A reference counted block of table storage. A snapshot shares every page
+ *  with its parent, and whichever table writes to a shared page first gets
+ *  its own copy of it. A page holds data only for the generation of its
+ *  array it was last written in; in any later generation it reads as empty.
+ */
+typedef struct page {
+  _Atomic int  refs;                 /**< tables using this page       */
+  unsigned     gen;                  /**< generation of the contents   */
+  _Alignas(64) unsigned char data[]; /**< the page's elements          */
+} page_t;
+
+/** Describes the elements stored in one kind of page */
+typedef struct page_kind {
+  int    shift;                        /**< log2 of elements per page     */
+  size_t elem_size;                    /**< size of one element           */
+  int    fill;                         /**< byte value of a fresh page    */
+  int  (*copy) (mem_t* mem, page_t* page);    /**< take ownership of a copy     */
+  void (*release) (mem_t* mem, page_t* page); /**< free storage owned by a page */
+} page_kind_t;
+
+/** The start of a shared memory region holding a table. Everything in the
+ *  region refers to everything else by offset from this header, since each
+ *  process maps the region at a different address. The header also holds
+ *  the table's counters; a process copies them into its own
+ *  <code>sym_table_t</code> when it takes the lock, and a writer copies them
+ *  back before releasing it.
+ */
+typedef struct shm_header {
+  unsigned         magic;       /**< SHM_MAGIC once initialized            */
+  pthread_rwlock_t lock;        /**< shared by all attached processes      */
+  size_t           bytes;       /**< size of the region                    */
+  size_t           page_brk;    /**< offset of the next free page          */
+  size_t           page_end;    /**< offset of the end of the page area    */
+  size_t           name_base;   /**< offset of the long name area          */
+  size_t           name_brk;    /**< offset of the next free name byte     */
+  size_t           name_end;    /**< offset of the end of the name area    */
+  size_t           name_free[SHM_NAME_LISTS]; /**< freed name blocks, by
+                                                    size (0 ends a list) */
+  size_t           dirs[SHM_ARRAYS];   /**< offsets of page directories   */
+  int              npages[SHM_ARRAYS]; /**< entries in each directory     */
+  unsigned         gen;         /**< generation of the arrays              */
+  int              max_symbols; /**< capacity of the node array            */
+  int              size;        /**< the table's counters                  */
+  int              count;
+  int              live;
+  int              free_list;
+  int              order_len;
+} shm_header_t;
+
+/** An array of elements stored as a directory of pages. The pages of an
+ *  array in a shared region are found through a directory of offsets in the
+ *  region; <code>dir</code> then caches the addresses at which this process
+ *  sees them.
+ */
+typedef struct pvec {
+  const page_kind_t* kind;   /**< what the pages hold                  */
+  mem_t*             mem;    /**< where the pages come from            */
+  page_t**           dir;    /**< page directory, NULL if not in use   */
+  int                npages; /**< number of entries in the directory   */
+  shm_header_t*      shm;    /**< region holding the pages, or NULL    */
+  size_t*            offs;   /**< offsets of the pages in the region   */
+  unsigned           gen;    /**< pages of other generations are empty */
+} pvec_t;
+
+/** A slot of an address hash table: an address in use and the first node
+ *  at that address. An empty slot has node NIL.
+ */
+typedef struct addr_slot {
+  unsigned addr;          /**< the address                        */
+  int      node;          /**< first node at the address, or NIL  */
+} addr_slot_t;
+
+/** One worker of <code>symbol_iterate_parallel()</code> */
+typedef struct worker {
+  symbol_iter_t iter;     /**< the worker's part of the table     */
+  iterate_fnc_t fnc;      /**< function called for each symbol    */
+  void*         data;     /**< the worker's argument to fnc       */
+} worker_t;
+
+/** A duplicate definition found by <code>symbol_merge()</code> */
+typedef struct merge_dup {
+  int src;                /**< index of the source table          */
+  int pos;                /**< position in the source's order     */
+  int node;               /**< node number in the source table    */
+  int existing;           /**< node number of the definition kept */
+} merge_dup_t;
+
+/** One worker of <code>symbol_merge()</code>, which owns a range of hash
+ *  table indices of the destination table.
+ */
+typedef struct merge_worker {
+  sym_table_t*  dst;      /**< table merged into                  */
+  sym_table_t** srcs;     /**< tables merged from                 */
+  const int*    base;     /**< first node number for each source  */
+  int           nsrcs;    /**< number of source tables            */
+  int           lo;       /**< first index owned by this worker   */
+  int           hi;       /**< index after the last one owned     */
+  int           added;    /**< number of symbols added            */
+  merge_dup_t*  dups;     /**< duplicates found, in source order  */
+  int           ndups;    /**< number of duplicates found         */
+  int           maxdups;  /**< capacity of dups                   */
+  int           failed;   /**< set if the allocator failed        */
+} merge_worker_t;
+
+/** Defines the data structure for the symbol table */
+struct sym_table {
+  mem_t*   mem;         /**< allocator and accounts of the table      */
+  int      size;        /**< size of hash table                       */
+  int      count;       /**< number of nodes allocated                */
+  int      live;        /**< number of nodes holding a symbol         */
+  int      free_list;   /**< first node of removed symbols, or NIL    */
+  pvec_t   hash_table;  /**< first node number at each index          */
+  pvec_t   nodes;       /**< the nodes, indexed by node number        */
+  pvec_t   order;       /**< node numbers in insertion order, NIL for
+                             a symbol since removed                   */
+  pvec_t   place;       /**< position of each node in order           */
+  int      order_len;   /**< entries of order in use                  */
+  pvec_t   addr_table;  /**< first node number at each address, or
+                             address slots when addr_slot_bits > 0    */
+  unsigned addr_limit;  /**< addresses below this are indexed         */
+  int      addr_slot_bits; /**< log2 of address hash slots, 0 if dense */
+  int      addr_used;   /**< address hash slots in use                */
+  pvec_t   bloom;       /**< Bloom filter of the names, if enabled    */
+  int      bloom_blocks;/**< size of the filter in blocks, 0 if off   */
+  int      bloom_bits;  /**< bits of filter per symbol                */
+  shm_header_t* shm;    /**< region holding the table, or NULL        */
+  pvec_t   views;       /**< this process's symbol_t for each node    */
+  int      pack_names;  /**< put new long names in the name store     */
+  pvec_t   names;       /**< the name store, front coded              */
+  unsigned names_brk;   /**< offset of the next free byte of the store */
+  unsigned names_block; /**< offset of the store's current block      */
+  int      names_in_block; /**< names in the current block, NAMES_BLOCK
+                                when the next name starts a new one    */
+  char     names_last[NAME_LONG]; /**< the name added to the store last */
+  _Atomic uint64_t* hot; /**< hot symbol cache slots, or NULL          */
+  int      hot_mask;    /**< number of cache slots - 1                */
+  _Atomic int hot_score; /**< credit of the cache, see hot_find()     */
+};
+
+/** One cache line of a blocked Bloom filter. All the bits for a name are in
+ *  the same block, so testing a name costs a single memory access.
+ */
+typedef struct bloom_block {
+  _Alignas(64) uint64_t words[8]; /**< 512 bits */
+} bloom_block_t;
+
+/** Does a node keep its name outside of the node? */
+static inline int name_is_long (const node_t* node) {
+  return node->len >= NAME_INLINE;
+}
+
+/** Length of a name, saturated to fit a node's length byte */
+static inline unsigned char name_len (const char* name) {
+  size_t len = strlen(name);
+  return (len < NAME_LONG) ? (unsigned char) len : NAME_LONG;
+}
+
+/** The first <code>NAME_PREFIX</code> characters of a name in lower case,
+ *  packed so that two prefixes can be compared as integers.
+ */
+static inline uint64_t name_prefix (const char* name) {
+  char     folded[NAME_PREFIX] = { 0 };
+  uint64_t prefix;
+
+  for (int i = 0; i < NAME_PREFIX && name[i]; i++)
+    folded[i] = tolower((unsigned char) name[i]);
+
+  memcpy(&prefix, folded, sizeof(prefix));
+  return prefix;
+}
+
+/** Is a node's long name kept in the table's name store? */
+static inline int name_is_packed (const node_t* node) {
+  return name_is_long(node) && node->short_name[NAME_INLINE - 1] == NAME_PACKED;
+}
+
+/** Was a node's name copied with mem_strdup() when it was added? Only ever
+ *  asked of nodes of private tables.
+ */
+static inline int name_is_heap (const node_t* node) {
+  return name_is_long(node) && node->short_name[NAME_INLINE - 1] != NAME_PACKED;
+}
+
+/** Does a node own a copy of its name allocated with mem_strdup()? Besides
+ *  a name copied when it was added, that is the copy of a name in the name
+ *  store once it has been decoded (see <code>name_decode()</code>). Only
+ *  ever asked of nodes of private tables, by the thread that writes them.
+ */
+static inline int name_is_owned (const node_t* node) {
+  return name_is_long(node) && node->symbol.name;
+}
+
+/** Does a node hold a symbol? This does not read the name pointer, which a
+ *  node in a shared region never has.
+ */
+static inline int node_used (const node_t* node) {
+  return node->hash != NIL;
+}
+
+/** Allocate from the C heap, for tables created without an allocator */
+static void* heap_alloc (size_t bytes, size_t align, void* context) {
+  (void) context;
+
+  if (align <= _Alignof(max_align_t))
+    return malloc(bytes);
+
+  return aligned_alloc(align, (bytes + align - 1) & ~(align - 1));
+}
+
+/** Free a block allocated by <code>heap_alloc()</code> */
+static void heap_free (void* ptr, size_t bytes, void* context) {
+  (void) bytes;
+  (void) context;
+  free(ptr);
+}
+
+/** The allocator of tables created without one */
+static const symbol_alloc_t heap = { heap_alloc, heap_free, NULL };
+
+/** Allocate <code>bytes</code> bytes aligned to <code>align</code> and count
+ *  them as live. Returns NULL, as if the allocator had failed, if they do
+ *  not fit in the budget; the bytes are counted before the allocator is
+ *  called, so threads allocating at once cannot together go past it.
+ */
+static void* mem_alloc (mem_t* mem, size_t bytes, size_t align) {
+  size_t live = atomic_fetch_add_explicit(&mem->live, bytes, memory_order_relaxed) + bytes;
+  void*  ptr  = NULL;
+
+  if (! mem->budget || live <= mem->budget)
+    ptr = mem->alloc.alloc(bytes, align, mem->alloc.context);
+
+  if (! ptr) {
+    atomic_fetch_sub_explicit(&mem->live, bytes, memory_order_relaxed);
+    return NULL;
+  }
+
+  size_t peak = atomic_load_explicit(&mem->peak, memory_order_relaxed);
+
+  while (live > peak &&
+         ! atomic_compare_exchange_weak_explicit(&mem->peak, &peak, live,
+                                                 memory_order_relaxed, memory_order_relaxed))
+    ;
+
+  return ptr;
+}
+
+/** Like <code>mem_alloc()</code>, but for an array of <code>n</code>
+ *  elements of <code>size</code> bytes, set to zero.
+ */
+static void* mem_calloc (mem_t* mem, size_t n, size_t size) {
+  void* ptr = mem_alloc(mem, n * size, _Alignof(max_align_t));
+
+  if (ptr)
+    memset(ptr, 0, n * size);
+
+  return ptr;
+}
+
+/** Free a block of <code>bytes</code> bytes allocated by
+ *  <code>mem_alloc()</code>. Does nothing if <code>ptr</code> is NULL.
+ */
+static void mem_free (mem_t* mem, void* ptr, size_t bytes) {
+  if (ptr) {
+    mem->alloc.free(ptr, bytes, mem->alloc.context);
+    atomic_fetch_sub_explicit(&mem->live, bytes, memory_order_relaxed);
+  }
+}
+
+/** Return a copy of a string allocated by <code>mem_alloc()</code> */
+static char* mem_strdup (mem_t* mem, const char* str) {
+  size_t bytes = strlen(str) + 1;
+  char*  copy  = mem_alloc(mem, bytes, 1);
+
+  if (copy)
+    memcpy(copy, str, bytes);
+
+  return copy;
+}
+
+/** Free a string allocated by <code>mem_strdup()</code> */
+static void mem_strfree (mem_t* mem, char* str) {
+  if (str)
+    mem_free(mem, str, strlen(str) + 1);
+}
+
+/** Is there room within the budget for <code>bytes</code> more bytes? A
+ *  function that must not fail half way checks this for the most it could
+ *  allocate before it starts.
+ */
+static inline int mem_room (mem_t* mem, size_t bytes) {
+  return ! mem->budget ||
+         atomic_load_explicit(&mem->live, memory_order_relaxed) + bytes <= mem->budget;
+}
+
+/** Create the accounts of a new table, which take memory from
+ *  <code>alloc</code> (counted against the budget like the rest).
+ */
+static mem_t* mem_new (const symbol_alloc_t* alloc, size_t budget) {
+  mem_t* mem = alloc->alloc(sizeof(mem_t), _Alignof(mem_t), alloc->context);
+
+  if (! mem)
+    return NULL;
+
+  mem->alloc  = *alloc;
+  mem->budget = budget;
+  atomic_init(&mem->refs, 1);
+  atomic_init(&mem->live, sizeof(mem_t));
+  atomic_init(&mem->peak, sizeof(mem_t));
+  return mem;
+}
+
+/** Stop using a table's accounts, freeing them with the last table */
+static void mem_release (mem_t* mem) {
+  if (atomic_fetch_sub(&mem->refs, 1) == 1)
+    mem->alloc.free(mem, sizeof(mem_t), mem->alloc.context);
+}
+
+/** Point the names of a copied page of nodes at storage the copy owns
+ *  @return 1 on success, 0 if a name could not be copied, in which case the
+ *  copies already made are freed again
+ */
+static int node_page_copy (mem_t* mem, page_t* page) {
+  node_t* nodes = (node_t*) page->data;
+
+  for (int i = 0; i < (1 << NODE_SHIFT); i++) {
+    if (! node_used(&nodes[i]))
+      continue;
+
+    //a decoded name stays with the page it was decoded in
+    if (! name_is_heap(&nodes[i])) {
+      nodes[i].symbol.name = name_is_long(&nodes[i]) ? NULL : nodes[i].short_name;
+      continue;
+    }
+
+    char* copy = mem_strdup(mem, nodes[i].symbol.name);
+
+    if (! copy) {
+      while (--i >= 0) {
+        if (node_used(&nodes[i]) && name_is_heap(&nodes[i]))
+          mem_strfree(mem, nodes[i].symbol.name);
+      }
+
+      return 0;
+    }
+
+    nodes[i].symbol.name = copy;
+  }
+
+  return 1;
+}
+
+/** Free the names owned by a page of nodes */
+static void node_page_release (mem_t* mem, page_t* page) {
+  node_t* nodes = (node_t*) page->data;
+
+  for (int i = 0; i < (1 << NODE_SHIFT); i++) {
+    if (node_used(&nodes[i]) && name_is_owned(&nodes[i]))
+      mem_strfree(mem, nodes[i].symbol.name);
+  }
+}
+
+/** Pages of node numbers, initialized to NIL */
+static const page_kind_t index_pages = {
+  BUCKET_SHIFT, sizeof(int), 0xFF, NULL, NULL
+};
+
+/** Pages of nodes, initialized to zero */
+static const page_kind_t node_pages = {
+  NODE_SHIFT, sizeof(node_t), 0, node_page_copy, node_page_release
+};
+
+/** Pages of the address table, initialized to NIL */
+static const page_kind_t addr_pages = {
+  ADDR_SHIFT, sizeof(int), 0xFF, NULL, NULL
+};
+
+/** Pages of address hash table slots, initialized to empty */
+static const page_kind_t addr_slot_pages = {
+  ADDR_SHIFT, sizeof(addr_slot_t), 0xFF, NULL, NULL
+};
+
+/** Pages of a name store */
+static const page_kind_t name_store_pages = {
+  NAMES_SHIFT, 1, 0, NULL, NULL
+};
+
+/** Pages of per-process symbol views of a shared table */
+static const page_kind_t view_pages = {
+  NODE_SHIFT, sizeof(symbol_t), 0, NULL, NULL
+};
+
+/** Pages of Bloom filter blocks, initialized to zero */
+static const page_kind_t bloom_pages = {
+  BLOOM_SHIFT, sizeof(bloom_block_t), 0, NULL, NULL
+};
+
+/** Return the number of bytes a page of a kind takes */
+static inline size_t page_bytes (const page_kind_t* kind) {
+  return sizeof(page_t) + (kind->elem_size << kind->shift);
+}
+
+/** Allocate a page of generation <code>gen</code> whose elements all have
+ *  the kind's initial value, or return NULL if the allocator fails.
+ */
+static page_t* page_new (mem_t* mem, const page_kind_t* kind, unsigned gen) {
+  size_t  bytes = kind->elem_size << kind->shift;
+  page_t* page  = mem_alloc(mem, page_bytes(kind), _Alignof(page_t));
+
+  if (! page)
+    return NULL;
+
+  atomic_init(&page->refs, 1);
+  page->gen = gen;
+  memset(page->data, kind->fill, bytes);
+  return page;
+}
+
+/** Allocate page <code>p</code> of an array in a shared region. The region
+ *  has room for every page of every array, so this cannot fail.
+ */
+static page_t* shm_page_new (pvec_t* vec, int p) {
+  shm_header_t* shm   = vec->shm;
+  size_t        bytes = vec->kind->elem_size << vec->kind->shift;
+  page_t*       page  = (page_t*) ((char*) shm + shm->page_brk);
+
+  atomic_init(&page->refs, 1);
+  page->gen = vec->gen;
+  memset(page->data, vec->kind->fill, bytes);
+  vec->offs[p]   = shm->page_brk;
+  shm->page_brk += sizeof(page_t) + bytes;
+  return page;
+}
+
+/** Drop one reference to a page, freeing it when no table uses it */
+static void page_drop (const pvec_t* vec, page_t* page) {
+  if (page && atomic_fetch_sub(&page->refs, 1) == 1) {
+    if (vec->kind->release)
+      vec->kind->release(vec->mem, page);
+    mem_free(vec->mem, page, page_bytes(vec->kind));
+  }
+}
+
+/** Initialize an empty paged array large enough for <code>count</code>
+ *  elements (it grows on demand past that).
+ *  @return 1 on success, 0 if there is no memory for its page directory, in
+ *  which case the array has no pages and can still be freed
+ */
+static int pvec_init (pvec_t* vec, const page_kind_t* kind, int count, mem_t* mem) {
+  vec->kind   = kind;
+  vec->mem    = mem;
+  vec->npages = ((count - 1) >> kind->shift) + 1;
+  vec->dir    = mem_calloc(mem, vec->npages, sizeof(page_t*));
+  vec->shm    = NULL;
+  vec->offs   = NULL;
+  vec->gen    = 0;
+
+  if (! vec->dir && vec->npages) {
+    vec->npages = 0;
+    return 0;
+  }
+
+  return 1;
+}
+
+/** Initialize paged array <code>k</code> of a shared region
+ *  @return 1 on success, 0 as for <code>pvec_init()</code>
+ */
+static int pvec_init_shm (pvec_t* vec, const page_kind_t* kind, shm_header_t* shm, int k,
+                          mem_t* mem) {
+  vec->kind   = kind;
+  vec->mem    = mem;
+  vec->npages = shm->npages[k];
+  vec->dir    = mem_calloc(mem, vec->npages, sizeof(page_t*));
+  vec->shm    = shm;
+  vec->offs   = (size_t*) ((char*) shm + shm->dirs[k]);
+  vec->gen    = shm->gen;
+
+  if (! vec->dir && vec->npages) {
+    vec->npages = 0;
+    return 0;
+  }
+
+  return 1;
+}
+
+/** Find page <code>p</code> of an array in a shared region that this process
+ *  has not used yet (another process may have allocated it).
+ */
+static page_t* pvec_map (const pvec_t* vec, int p) {
+  if (! vec->offs || p >= vec->npages || ! vec->offs[p])
+    return NULL;
+
+  return vec->dir[p] = (page_t*) ((char*) vec->shm + vec->offs[p]);
+}
+
+/** Return a pointer to element <code>i</code> for reading, or NULL if the
+ *  page holding it has not been written in the current generation.
+ */
+static inline void* pvec_read (const pvec_t* vec, int i) {
+  int     p    = i >> vec->kind->shift;
+  page_t* page = (p < vec->npages) ? vec->dir[p] : NULL;
+
+  if (! page && ! (page = pvec_map(vec, p)))
+    return NULL;
+
+  if (page->gen != vec->gen)
+    return NULL;
+
+  return page->data + (size_t) (i & ((1 << vec->kind->shift) - 1)) * vec->kind->elem_size;
+}
+
+/** Return a pointer to element <code>i</code> for writing. The page holding
+ *  it is allocated if missing, emptied if it is left over from an earlier
+ *  generation, and copied if it is shared with another table. Returns NULL
+ *  if the allocator fails, leaving the array reading as it did; once it has
+ *  succeeded, writing to the same page cannot fail again until the array is
+ *  shared or retired.
+ */
+static void* pvec_write (pvec_t* vec, int i) {
+  const page_kind_t* kind = vec->kind;
+  int p = i >> kind->shift;
+
+  if (p >= vec->npages) {
+    int npages = vec->npages * 2;
+
+    if (npages <= p)
+      npages = p + 1;
+
+    page_t** dir = mem_calloc(vec->mem, npages, sizeof(page_t*));
+
+    if (! dir)
+      return NULL;
+
+    memcpy(dir, vec->dir, vec->npages * sizeof(page_t*));
+    mem_free(vec->mem, vec->dir, vec->npages * sizeof(page_t*));
+    vec->dir    = dir;
+    vec->npages = npages;
+  }
+
+  page_t* page = vec->dir[p];
+
+  if (! page)
+    page = pvec_map(vec, p);
+
+  if (page && page->gen != vec->gen) {
+    //a snapshot may still be using the old contents; otherwise reclaim them
+    if (atomic_load(&page->refs) > 1) {
+      page_drop(vec, page);
+      page = vec->dir[p] = NULL;
+    } else {
+      if (kind->release && ! vec->shm)
+        kind->release(vec->mem, page);
+
+      memset(page->data, kind->fill, kind->elem_size << kind->shift);
+      page->gen = vec->gen;
+    }
+  }
+
+  //should this fail, a stale page given up above reads as empty, as it did
+  if (! page) {
+    page = vec->shm ? shm_page_new(vec, p) : page_new(vec->mem, kind, vec->gen);
+
+    if (! page)
+      return NULL;
+
+    vec->dir[p] = page;
+  }
+  else if (atomic_load(&page->refs) > 1) {
+    debug("copying shared page %d", p);
+    page_t* copy = page_new(vec->mem, kind, vec->gen);
+
+    if (! copy)
+      return NULL;
+
+    memcpy(copy->data, page->data, kind->elem_size << kind->shift);
+
+    if (kind->copy && ! kind->copy(vec->mem, copy)) {
+      mem_free(vec->mem, copy, page_bytes(kind));
+      return NULL;
+    }
+
+    page_drop(vec, page);
+    page = vec->dir[p] = copy;
+  }
+
+  return page->data + (size_t) (i & ((1 << kind->shift) - 1)) * kind->elem_size;
+}
+
+/** Make the pages holding elements <code>first</code> to <code>last</code>
+ *  of an array writable, so that writing to them cannot fail.
+ *  @return 1 on success, 0 if the allocator failed
+ */
+static int pvec_ready (pvec_t* vec, int first, int last) {
+  int shift = vec->kind->shift;
+
+  for (int p = first >> shift; first <= last && p <= last >> shift; p++) {
+    if (! pvec_write(vec, p << shift))
+      return 0;
+  }
+
+  return 1;
+}
+
+/** Make <code>dst</code> a copy of <code>src</code> that shares all its pages
+ *  @return 1 on success, 0 if there is no memory for the page directory, in
+ *  which case <code>dst</code> has no pages and can still be freed
+ */
+static int pvec_share (pvec_t* dst, const pvec_t* src) {
+  *dst     = *src;
+  dst->dir = mem_alloc(src->mem, src->npages * sizeof(page_t*), _Alignof(page_t*));
+
+  if (! dst->dir && src->npages) {
+    dst->npages = 0;
+    return 0;
+  }
+
+  memcpy(dst->dir, src->dir, src->npages * sizeof(page_t*));
+
+  for (int p = 0; p < src->npages; p++) {
+    if (src->dir[p])
+      atomic_fetch_add(&src->dir[p]->refs, 1);
+  }
+
+  return 1;
+}
+
+/** Free the page directory of a paged array whose pages have been dropped */
+static void pvec_free (pvec_t* vec) {
+  mem_free(vec->mem, vec->dir, vec->npages * sizeof(page_t*));
+  vec->dir = NULL;
+}
+
+/** Drop every page of a paged array, leaving it empty. The pages of an
+ *  array in a shared region are emptied in place instead, since other
+ *  processes may still refer to them.
+ */
+static void pvec_clear (pvec_t* vec) {
+  for (int p = 0; p < vec->npages; p++) {
+    if (vec->shm) {
+      page_t* page = vec->dir[p] ? vec->dir[p] : pvec_map(vec, p);
+
+      if (page)
+        memset(page->data, vec->kind->fill, vec->kind->elem_size << vec->kind->shift);
+    } else {
+      page_drop(vec, vec->dir[p]);
+      vec->dir[p] = NULL;
+    }
+  }
+}
+
+/** Empty a paged array in constant time by starting a new generation. Its
+ *  pages are kept, and each is emptied (or replaced, if a snapshot still
+ *  uses it) the next time it is written. Only when the generation number
+ *  wraps around, once in 2^32 calls, is every page emptied at once, so that
+ *  no old page can be mistaken for a current one.
+ */
+static void pvec_retire (pvec_t* vec) {
+  if (++vec->gen == 0)
+    pvec_clear(vec);
+}
+
+/** Find the entry of a node's name in the name store. A name store is a
+ *  byte array of entries, each holding the length of the prefix the name
+ *  shares with the name before it, the length of the rest, and the rest.
+ *  The entries are grouped in blocks of up to <code>NAMES_BLOCK</code>
+ *  names whose first entry shares nothing, and a block never spans a page.
+ *  @param first - set to the first entry of the name's block
+ *  @return the name's entry
+ */
+static const unsigned char* name_entry (const sym_table_t* symTab, const node_t* node,
+                                        const unsigned char** first) {
+  uint32_t block;
+  uint16_t delta;
+
+  memcpy(&block, node->short_name, sizeof(block));
+  memcpy(&delta, node->short_name + sizeof(block), sizeof(delta));
+  *first = pvec_read(&symTab->names, block);
+  return *first + delta;
+}
+
+/** Decode the name of a node whose name is in the name store */
+static void name_unpack (const sym_table_t* symTab, const node_t* node, char* buf) {
+  const unsigned char* p;
+  const unsigned char* last = name_entry(symTab, node, &p);
+
+  for (;; p += 2 + p[1]) {
+    memcpy(buf + p[0], p + 2, p[1]);
+
+    if (p == last) {
+      buf[p[0] + p[1]] = '\0';
+      return;
+    }
+  }
+}
+
+/** Is the name of a node in the name store <code>name</code>, ignoring case?
+ *  Walks the node's block keeping count of how many characters of
+ *  <code>name</code> the current entry matches. An entry that shares more
+ *  with the entry before it than that entry matched fails at the same
+ *  character, so only the rest of an entry that shares no more than was
+ *  matched is ever compared, and no name is decoded.
+ */
+static int name_packed_is (const sym_table_t* symTab, const node_t* node, const char* name) {
+  const unsigned char* p;
+  const unsigned char* last    = name_entry(symTab, node, &p);
+  size_t               len     = node->len;
+  size_t               matched = 0;
+
+  for (;; p += 2 + p[1]) {
+    size_t shared = p[0];
+    size_t end    = shared + p[1];
+
+    if (matched >= shared) {
+      matched = shared;
+
+      while (matched < end &&
+             tolower(p[2 + matched - shared]) == tolower((unsigned char) name[matched]))
+        matched++;
+    }
+
+    if (p == last)
+      return matched == end && end == len;
+  }
+}
+
+/** Append a long name to the table's name store and record its place in the
+ *  node. The name is coded against the one appended before it, unless it
+ *  starts a new block.
+ *  @return 1 on success, 0 if the store could not grow
+ */
+static int name_pack (sym_table_t* symTab, node_t* node, const char* name) {
+  unsigned page   = 1u << NAMES_SHIFT;
+  unsigned brk    = symTab->names_brk;
+  size_t   len    = node->len;
+  size_t   shared = 0;
+
+  if ((brk & (page - 1)) + 2 + len > page)
+    brk = (brk + page - 1) & ~(page - 1);
+
+  unsigned char* entry = pvec_write(&symTab->names, brk);
+
+  if (! entry)
+    return 0;
+
+  //a block never spans a page
+  if ((brk & (page - 1)) == 0 || symTab->names_in_block == NAMES_BLOCK) {
+    symTab->names_block    = brk;
+    symTab->names_in_block = 0;
+  }
+  else {
+    while (shared < len && name[shared] == symTab->names_last[shared])
+      shared++;
+  }
+
+  uint32_t block = symTab->names_block;
+  uint16_t delta = (uint16_t) (brk - block);
+
+  entry[0] = (unsigned char) shared;
+  entry[1] = (unsigned char) (len - shared);
+  memcpy(entry + 2, name + shared, len - shared);
+  memcpy(symTab->names_last, name, len + 1);
+
+  memcpy(node->short_name, &block, sizeof(block));
+  memcpy(node->short_name + sizeof(block), &delta, sizeof(delta));
+  node->short_name[NAME_INLINE - 1] = NAME_PACKED;
+  node->symbol.name = NULL;
+
+  symTab->names_brk = brk + 2 + (unsigned) (len - shared);
+  symTab->names_in_block++;
+  return 1;
+}
+
+_Static_assert(sizeof(_Atomic(char*)) == sizeof(char*),
+               "a name pointer should be replaceable by an atomic one");
+
+/** Return the name of a node whose name is in the name store, decoding it
+ *  the first time it is asked for into a copy the node keeps in
+ *  <code>symbol.name</code> from then on, so that the name and the node's
+ *  symbol stay put like those of a name copied when it was added. Lookups
+ *  may run on several threads at once, so the copy is published with a
+ *  compare and swap, and a thread that loses the race frees its own.
+ *  @return the name, or NULL if there is no memory to decode it into
+ */
+static char* name_decode (const sym_table_t* symTab, node_t* node) {
+  _Atomic(char*)* cache = (_Atomic(char*)*) &node->symbol.name;
+  char*           name  = atomic_load_explicit(cache, memory_order_acquire);
+  char            buf[NAME_LONG];
+
+  if (name)
+    return name;
+
+  name_unpack(symTab, node, buf);
+  char* copy = mem_strdup(symTab->mem, buf);
+
+  if (copy && ! atomic_compare_exchange_strong_explicit(cache, &name, copy,
+                                                        memory_order_acq_rel,
+                                                        memory_order_acquire)) {
+    mem_strfree(symTab->mem, copy);
+    return name;
+  }
+
+  return copy;
+}
+
+/** A freed block of a region's long name area, on the free list for its
+ *  size
+ */
+typedef struct shm_name_block {
+  size_t next;            /**< offset of the next free block, or 0 */
+  size_t bytes;           /**< size of this block                  */
+} shm_name_block_t;
+
+/** Return the bytes a long name of <code>len</code> characters takes in a
+ *  region, a multiple of SHM_NAME_GRAIN so that every block can hold a
+ *  <code>shm_name_block_t</code> once freed.
+ */
+static inline size_t shm_name_bytes (size_t len) {
+  return (len + SHM_NAME_GRAIN) & ~(size_t) (SHM_NAME_GRAIN - 1);
+}
+
+/** Return the free list that blocks of <code>bytes</code> bytes go on */
+static inline size_t* shm_name_list (shm_header_t* shm, size_t bytes) {
+  return &shm->name_free[(bytes <= SHM_NAME_SMALL) ? bytes / SHM_NAME_GRAIN - 1
+                                                   : SHM_NAME_LISTS - 1];
+}
+
+/** Return the offset of <code>bytes</code> bytes (from
+ *  <code>shm_name_bytes()</code>) in a region's long name area, or 0 if it
+ *  is full. A freed block of the same size is reused before the area grows,
+ *  so adding and removing names cannot use it up.
+ */
+static size_t shm_name_alloc (shm_header_t* shm, size_t bytes) {
+  size_t* link = shm_name_list(shm, bytes);
+  size_t  off  = shm->name_brk;
+
+  //every block on a list of small blocks has the size of the list
+  for (size_t next = *link; next; next = *link) {
+    shm_name_block_t* block = (shm_name_block_t*) ((char*) shm + next);
+
+    if (block->bytes == bytes) {
+      *link = block->next;
+      return next;
+    }
+
+    link = &block->next;
+  }
+
+  if (bytes > shm->name_end - off)
+    return 0;
+
+  shm->name_brk += bytes;
+  return off;
+}
+
+/** Give back <code>bytes</code> bytes at offset <code>off</code> of a
+ *  region's long name area
+ */
+static void shm_name_free (shm_header_t* shm, size_t off, size_t bytes) {
+  shm_name_block_t* block = (shm_name_block_t*) ((char*) shm + off);
+  size_t*           list  = shm_name_list(shm, bytes);
+
+  block->next  = *list;
+  block->bytes = bytes;
+  *list        = off;
+}
+
+/** Store a copy of <code>name</code> in a node. A node in a shared region,
+ *  or whose name is in the name store, keeps the place of its long name where
+ *  a short name would go. A node in a shared region has no
+ *  <code>symbol.name</code>, as a pointer would not be valid in other
+ *  processes, and one whose name is in the name store has none until the
+ *  name is first decoded (see <code>node_name()</code> and
+ *  <code>node_symbol()</code>).
+ *  @return 1 on success, 0 if there is no room for the name
+ */
+static int node_set_name (sym_table_t* symTab, node_t* node, const char* name) {
+  node->len    = name_len(name);
+  node->prefix = name_prefix(name);
+
+  if (! name_is_long(node)) {
+    memcpy(node->short_name, name, node->len + 1);
+    node->symbol.name = symTab->shm ? NULL : node->short_name;
+    return 1;
+  }
+
+  if (symTab->pack_names && node->len < NAME_LONG)
+    return name_pack(symTab, node, name);
+
+  node->short_name[NAME_INLINE - 1] = 0;
+
+  if (symTab->shm) {
+    size_t off = shm_name_alloc(symTab->shm, shm_name_bytes(strlen(name)));
+
+    if (off == 0)
+      return 0;
+
+    strcpy((char*) symTab->shm + off, name);
+    memcpy(node->short_name, &off, sizeof(off));
+    node->symbol.name = NULL;
+  }
+  else {
+    node->symbol.name = mem_strdup(symTab->mem, name);
+
+    if (! node->symbol.name)
+      return 0;
+  }
+
+  return 1;
+}
+
+/** Return the name of a node as this process sees it, or NULL if it is in
+ *  the name store and there is no memory to decode it.
+ */
+static inline char* node_name (const sym_table_t* symTab, node_t* node) {
+  size_t off;
+
+  if (name_is_packed(node))
+    return name_decode(symTab, node);
+
+  if (! symTab->shm)
+    return node->symbol.name;
+
+  if (! name_is_long(node))
+    return node->short_name;
+
+  memcpy(&off, node->short_name, sizeof(off));
+  return (char*) symTab->shm + off;
+}
+
+/** Free the storage of a node's name, if it has any of its own */
+static void node_free_name (sym_table_t* symTab, node_t* node) {
+  if (! node_used(node) || ! name_is_long(node))
+    return;
+
+  if (symTab->shm) {
+    char* name = node_name(symTab, node);
+    shm_name_free(symTab->shm, name - (char*) symTab->shm, shm_name_bytes(strlen(name)));
+  }
+  else if (name_is_owned(node)) {
+    mem_strfree(symTab->mem, node->symbol.name);
+  }
+}
+
+/** Return the node with the given number */
+static inline node_t* node_at (const sym_table_t* symTab, int n) {
+  return pvec_read(&symTab->nodes, n);
+}
+
+/** Return the symbol of node <code>n</code> to hand to a caller. A node in a
+ *  shared region cannot hold a name pointer that is valid in every process,
+ *  so for a shared table this is a copy of the symbol, private to this
+ *  process, whose name points into the region. A name in the name store is
+ *  decoded into the node first.
+ *  @return the symbol, or NULL if there is no memory to decode its name
+ */
+static inline symbol_t* node_symbol (sym_table_t* symTab, int n) {
+  node_t*   node = node_at(symTab, n);
+  symbol_t* view;
+
+  if (name_is_packed(node))
+    return name_decode(symTab, node) ? &node->symbol : NULL;
+
+  if (! symTab->shm)
+    return &node->symbol;
+
+  view       = pvec_write(&symTab->views, n);
+  view->name = node_name(symTab, node);
+  view->addr = node->symbol.addr;
+  return view;
+}
+
+/** Return the number of the first node at a hash table index, or NIL */
+static inline int bucket_head (const sym_table_t* symTab, int index) {
+  int* head = pvec_read(&symTab->hash_table, index);
+  return head ? *head : NIL;
+}
+
+/** Return the slot of an address hash table at which the search for an
+ *  address starts.
+ */
+static inline int addr_home (const sym_table_t* symTab, unsigned addr) {
+  return (int) ((addr * 0x9E3779B9u) >> (32 - symTab->addr_slot_bits));
+}
+
+/** Return the slot of an address hash table holding <code>addr</code>, or
+ *  the empty slot at which it would be added.
+ */
+static int addr_probe (const sym_table_t* symTab, unsigned addr) {
+  int mask = (1 << symTab->addr_slot_bits) - 1;
+  int i    = addr_home(symTab, addr);
+
+  for (;; i = (i + 1) & mask) {
+    const addr_slot_t* slot = pvec_read(&symTab->addr_table, i);
+
+    if (! slot || slot->node == NIL || slot->addr == addr)
+      return i;
+  }
+}
+
+/** Return the number of the node named at an address, or NIL */
+static inline int addr_node (const sym_table_t* symTab, int addr) {
+  if ((unsigned) addr >= symTab->addr_limit)
+    return NIL;
+
+  if (symTab->addr_slot_bits) {
+    const addr_slot_t* slot = pvec_read(&symTab->addr_table, addr_probe(symTab, addr));
+    return slot ? slot->node : NIL;
+  }
+
+  int* head = pvec_read(&symTab->addr_table, addr);
+  return head ? *head : NIL;
+}
+
+/** Empty slot <code>i</code> of an address hash table, moving back any later
+ *  address in the same run of slots that would no longer be found.
+ */
+static void addr_slot_delete (sym_table_t* symTab, int i) {
+  int mask = (1 << symTab->addr_slot_bits) - 1;
+
+  for (int j = (i + 1) & mask; ; j = (j + 1) & mask) {
+    const addr_slot_t* slot = pvec_read(&symTab->addr_table, j);
+
+    if (! slot || slot->node == NIL)
+      break;
+
+    //the slot can move to i unless its home lies cyclically in (i, j]
+    int home = addr_home(symTab, slot->addr);
+
+    if ((j > i) ? (home <= i || home > j) : (home <= i && home > j)) {
+      *(addr_slot_t*) pvec_write(&symTab->addr_table, i) = *slot;
+      i = j;
+    }
+  }
+
+  ((addr_slot_t*) pvec_write(&symTab->addr_table, i))->node = NIL;
+  symTab->addr_used--;
+}
+
+/** Double the number of slots of an address hash table. The new slots are
+ *  all allocated before the old ones are given up.
+ *  @return 1 on success, 0 if the allocator failed, leaving the table as it
+ *  was
+ */
+static int addr_grow (sym_table_t* symTab) {
+  pvec_t old  = symTab->addr_table;
+  int    size = 1 << symTab->addr_slot_bits;
+
+  debug("address hash table grows to %d slots", 2 * size);
+  symTab->addr_slot_bits++;
+
+  if (! pvec_init(&symTab->addr_table, &addr_slot_pages, 2 * size, symTab->mem) ||
+      ! pvec_ready(&symTab->addr_table, 0, 2 * size - 1)) {
+    pvec_clear(&symTab->addr_table);
+    pvec_free(&symTab->addr_table);
+    symTab->addr_table = old;
+    symTab->addr_slot_bits--;
+    return 0;
+  }
+
+  for (int i = 0; i < size; i++) {
+    const addr_slot_t* slot = pvec_read(&old, i);
+
+    if (slot && slot->node != NIL)
+      *(addr_slot_t*) pvec_write(&symTab->addr_table, addr_probe(symTab, slot->addr)) = *slot;
+  }
+
+  pvec_clear(&old);
+  pvec_free(&old);
+  return 1;
+}
+
+/** Make writable every slot of an address hash table from the one at which
+ *  the search for <code>addr</code> starts to the first empty one. Whatever
+ *  is added or removed, <code>addr</code> ends up in one of them.
+ *  @return 1 on success, 0 if the allocator failed
+ */
+static int addr_run_ready (sym_table_t* symTab, unsigned addr) {
+  int mask = (1 << symTab->addr_slot_bits) - 1;
+
+  for (int i = addr_home(symTab, addr); ; i = (i + 1) & mask) {
+    const addr_slot_t* slot = pvec_write(&symTab->addr_table, i);
+
+    if (! slot)
+      return 0;
+
+    if (slot->node == NIL)
+      return 1;
+  }
+}
+
+/** Get the address table ready to link symbols at <code>addr</code> without
+ *  allocating: grow an address hash table that could not take
+ *  <code>more</code> new addresses, then make writable the entry or slots
+ *  the address may go in and the nodes of the symbols already at it.
+ *  @return 1 on success, 0 if the allocator failed, leaving the table
+ *  unchanged in content
+ */
+static int addr_link_ready (sym_table_t* symTab, int addr, int more) {
+  if ((unsigned) addr >= symTab->addr_limit)
+    return 1;
+
+  if (symTab->addr_slot_bits) {
+    while (4LL * (symTab->addr_used + more) > 3LL << symTab->addr_slot_bits) {
+      if (! addr_grow(symTab))
+        return 0;
+    }
+
+    if (! addr_run_ready(symTab, addr))
+      return 0;
+  }
+  else if (! pvec_write(&symTab->addr_table, addr)) {
+    return 0;
+  }
+
+  for (int n = addr_node(symTab, addr); n != NIL; n = node_at(symTab, n)->addr_next) {
+    if (! pvec_write(&symTab->nodes, n))
+      return 0;
+  }
+
+  return 1;
+}
+
+/** Get the address table ready to unlink node <code>n</code> without
+ *  allocating: make writable the symbols at its address before it, and the
+ *  entry or slots for the address.
+ *  @return 1 on success, 0 if the allocator failed
+ */
+static int addr_unlink_ready (sym_table_t* symTab, int n) {
+  int addr = node_at(symTab, n)->symbol.addr;
+
+  if ((unsigned) addr >= symTab->addr_limit)
+    return 1;
+
+  for (int m = addr_node(symTab, addr); m != NIL && m != n; m = node_at(symTab, m)->addr_next) {
+    if (! pvec_write(&symTab->nodes, m))
+      return 0;
+  }
+
+  if (symTab->addr_slot_bits)
+    return addr_run_ready(symTab, addr);
+
+  return pvec_write(&symTab->addr_table, addr) != NULL;
+}
+
+/** Make node <code>n</code> (or NIL, for none) the first node at an address
+ *  in the address table.
+ */
+static void addr_set_head (sym_table_t* symTab, unsigned addr, int n) {
+  if (! symTab->addr_slot_bits) {
+    *(int*) pvec_write(&symTab->addr_table, addr) = n;
+    return;
+  }
+
+  int i = addr_probe(symTab, addr);
+  const addr_slot_t* slot = pvec_read(&symTab->addr_table, i);
+
+  if (slot && slot->node != NIL) {
+    if (n == NIL)
+      addr_slot_delete(symTab, i);
+    else
+      ((addr_slot_t*) pvec_write(&symTab->addr_table, i))->node = n;
+    return;
+  }
+
+  if (n == NIL)
+    return;
+
+  //addr_link_ready() has kept the table at most three quarters full
+
+  addr_slot_t* empty = pvec_write(&symTab->addr_table, i);
+  empty->addr = addr;
+  empty->node = n;
+  symTab->addr_used++;
+}
+
+/** Add node <code>n</code> to the end of the chain of symbols at its
+ *  address. The address table names the head of the chain, which is the
+ *  oldest symbol at that address.
+ */
+static void addr_link (sym_table_t* symTab, int n) {
+  node_t* node = pvec_write(&symTab->nodes, n);
+  int     addr = node->symbol.addr;
+  int     tail = addr_node(symTab, addr);
+
+  node->addr_next = NIL;
+
+  if ((unsigned) addr >= symTab->addr_limit)
+    return;
+
+  if (tail == NIL) {
+    addr_set_head(symTab, addr, n);
+    return;
+  }
+
+  while (node_at(symTab, tail)->addr_next != NIL)
+    tail = node_at(symTab, tail)->addr_next;
+
+  ((node_t*) pvec_write(&symTab->nodes, tail))->addr_next = n;
+}
+
+/** Take node <code>n</code> out of the chain of symbols at its address. If
+ *  it was named in the address table, the next alias takes its place.
+ */
+static void addr_unlink (sym_table_t* symTab, int n) {
+  node_t* node = node_at(symTab, n);
+  int     addr = node->symbol.addr;
+  int     prev = NIL;
+  int     curr = addr_node(symTab, addr);
+
+  while (curr != NIL && curr != n) {
+    prev = curr;
+    curr = node_at(symTab, curr)->addr_next;
+  }
+
+  if (curr == NIL)
+    return;
+
+  if (prev == NIL)
+    addr_set_head(symTab, addr, node->addr_next);
+  else
+    ((node_t*) pvec_write(&symTab->nodes, prev))->addr_next = node->addr_next;
+}
+
+/** Return the number of a node to hold a new symbol, reusing the node of a
+ *  removed symbol if there is one. Returns NIL if a shared table is full.
+ */
+static int node_alloc (sym_table_t* symTab) {
+  int n = symTab->free_list;
+
+  if (n != NIL)
+    symTab->free_list = node_at(symTab, n)->next;
+  else if (symTab->shm && symTab->count >= symTab->shm->max_symbols)
+    return NIL;
+  else
+    n = symTab->count++;
+
+  symTab->live++;
+  return n;
+}
+
+/** Put node <code>n</code>, whose name has been freed, on the free list */
+static void node_unalloc (sym_table_t* symTab, int n) {
+  node_t* node = pvec_write(&symTab->nodes, n);
+
+  node->symbol.name = NULL;
+  node->hash        = NIL;
+  node->len         = 0;
+  node->next        = symTab->free_list;
+  symTab->free_list = n;
+  symTab->live--;
+}
+
+/** Return the node at position <code>pos</code> of the insertion order, or
+ *  NIL if its symbol has been removed.
+ */
+static inline int order_node (const sym_table_t* symTab, int pos) {
+  const int* n = pvec_read(&symTab->order, pos);
+  return n ? *n : NIL;
+}
+
+/** Make writable the entries that putting node <code>n</code> and the
+ *  <code>more - 1</code> nodes after it last in insertion order will write.
+ *  @return 1 on success, 0 if the allocator failed
+ */
+static int order_ready (sym_table_t* symTab, int n, int more) {
+  return pvec_ready(&symTab->order, symTab->order_len, symTab->order_len + more - 1) &&
+         pvec_ready(&symTab->place, n, n + more - 1);
+}
+
+/** Put node <code>n</code> last in insertion order, after
+ *  <code>order_ready()</code>.
+ */
+static void order_append (sym_table_t* symTab, int n) {
+  *(int*) pvec_write(&symTab->order, symTab->order_len) = n;
+  *(int*) pvec_write(&symTab->place, n) = symTab->order_len++;
+}
+
+/** Return the entry of the insertion order that holds node <code>n</code>,
+ *  made writable, or NULL if the allocator failed.
+ */
+static int* order_entry (sym_table_t* symTab, int n) {
+  return pvec_write(&symTab->order, *(const int*) pvec_read(&symTab->place, n));
+}
+
+/** Close up the gaps removed symbols left in the insertion order once they
+ *  outnumber the symbols, so that iteration costs at most twice what it
+ *  would without them. Compacting is only an optimization: should the
+ *  allocator fail, the order is left as it was.
+ */
+static void order_compact (sym_table_t* symTab) {
+  int len = 0;
+
+  if (symTab->order_len - symTab->live <= symTab->live ||
+      ! pvec_ready(&symTab->order, 0, symTab->live - 1) ||
+      ! pvec_ready(&symTab->place, 0, symTab->count - 1))
+    return;
+
+  debug("compacting %d places to %d", symTab->order_len, symTab->live);
+
+  for (int pos = 0; pos < symTab->order_len; pos++) {
+    int n = order_node(symTab, pos);
+
+    if (n != NIL) {
+      *(int*) pvec_write(&symTab->order, len) = n;
+      *(int*) pvec_write(&symTab->place, n) = len++;
+    }
+  }
+
+  symTab->order_len = len;
+}
+
+/** Spread the bits of a symbol hash over 64 bits. The top half selects a
+ *  Bloom filter block and the bottom half the bits within it.
+ */
+static inline uint64_t bloom_mix (int hash) {
+  uint64_t x = (uint64_t) hash * 0x9E3779B97F4A7C15ULL;
+  x ^= x >> 29;
+  x *= 0xBF58476D1CE4E5B9ULL;
+  x ^= x >> 32;
+  x *= 0x94D049BB133111EBULL;
+  return x ^ (x >> 29);
+}
+
+/** Return the number of the filter block for a mixed hash */
+static inline int bloom_block (const sym_table_t* symTab, uint64_t mix) {
+  return (int) (((mix >> 32) * (uint64_t) symTab->bloom_blocks) >> 32);
+}
+
+/** Set the filter bits of a symbol hash
+ *  @return 1 on success, 0 if the allocator failed
+ */
+static int bloom_add (sym_table_t* symTab, int hash) {
+  uint64_t       mix   = bloom_mix(hash);
+  bloom_block_t* block = pvec_write(&symTab->bloom, bloom_block(symTab, mix));
+
+  if (! block)
+    return 0;
+
+  for (int i = 0; i < BLOOM_PROBES; i++, mix >>= 9)
+    block->words[(mix >> 6) & 7] |= 1ULL << (mix & 63);
+
+  return 1;
+}
+
+/** Can a symbol with this hash be in the table? Always true without a
+ *  filter; false means the symbol is definitely absent.
+ */
+static inline int bloom_test (const sym_table_t* symTab, int hash) {
+  if (symTab->bloom_blocks == 0)
+    return 1;
+
+  uint64_t             mix   = bloom_mix(hash);
+  const bloom_block_t* block = pvec_read(&symTab->bloom, bloom_block(symTab, mix));
+
+  if (! block)
+    return 0;
+
+  for (int i = 0; i < BLOOM_PROBES; i++, mix >>= 9) {
+    if (! (block->words[(mix >> 6) & 7] & (1ULL << (mix & 63))))
+      return 0;
+  }
+
+  return 1;
+}
+
+/** Size a new filter for at least <code>symbols</code> symbols, set the bits
+ *  of every symbol in the table, and put it in place of the old one.
+ *  @return 1 on success, 0 if the allocator failed, leaving the old filter
+ */
+static int bloom_build (sym_table_t* symTab, int symbols) {
+  pvec_t    old    = symTab->bloom;
+  int       blocks = symTab->bloom_blocks;
+  long long bits   = (long long) symbols * symTab->bloom_bits;
+  int       built  = pvec_init(&symTab->bloom, &bloom_pages, 1, symTab->mem);
+
+  symTab->bloom_blocks = (int) ((bits + 511) / 512);
+  debug("building Bloom filter of %d blocks", symTab->bloom_blocks);
+
+  for (int i = 0; built && i < symTab->count; i++) {
+    node_t* node = node_at(symTab, i);
+
+    if (node_used(node))
+      built = bloom_add(symTab, node->hash);
+  }
+
+  pvec_t* drop = built ? &old : &symTab->bloom;
+  pvec_clear(drop);
+  pvec_free(drop);
+
+  if (! built) {
+    symTab->bloom        = old;
+    symTab->bloom_blocks = blocks;
+  }
+
+  return built;
+}
+
+/** Get the filter ready to record <code>more</code> new symbols without
+ *  allocating: double it first if they would take the table past what it
+ *  was sized for, then make writable the block of <code>hash</code>, or
+ *  every block if <code>hash</code> is NIL.
+ *  @return 1 on success, 0 if the allocator failed, leaving the filter
+ *  unchanged in content
+ */
+static int bloom_ready (sym_table_t* symTab, int hash, int more) {
+  long long live = (long long) symTab->live + more;
+
+  if (symTab->bloom_blocks == 0)
+    return 1;
+
+  if (live * symTab->bloom_bits > symTab->bloom_blocks * 512LL &&
+      ! bloom_build(symTab, (int) (2 * live)))
+    return 0;
+
+  if (hash == NIL)
+    return pvec_ready(&symTab->bloom, 0, symTab->bloom_blocks - 1);
+
+  return pvec_write(&symTab->bloom, bloom_block(symTab, bloom_mix(hash))) != NULL;
+}
+
+/** Record a new symbol in the filter, if the table has one. The filter must
+ *  have been made ready for it by <code>bloom_ready()</code>.
+ */
+static void bloom_insert (sym_table_t* symTab, int hash) {
+  if (symTab->bloom_blocks)
+    bloom_add(symTab, hash);
+}
+
+/** Return the bytes of a new array of <code>count</code> elements of a kind
+ *  with every page written, directory included.
+ */
+static size_t pvec_bytes (const page_kind_t* kind, long long count) {
+  long long pages = ((count - 1) >> kind->shift) + 1;
+  return (size_t) pages * (page_bytes(kind) + sizeof(page_t*));
+}
+
+/** Return the most bytes that writing elements <code>first</code> to
+ *  <code>last</code> of an array could allocate, if at most
+ *  <code>limit</code> of its pages are written: the pages not yet allocated
+ *  or shared with a snapshot (a page of this table's own left from an
+ *  earlier generation is reused), and a larger directory if
+ *  <code>last</code> lies past the end of this one. The names a copied page
+ *  of nodes copies in turn are not included.
+ */
+static size_t pvec_reserve (const pvec_t* vec, long long first, long long last, long long limit) {
+  long long lo      = first >> vec->kind->shift;
+  long long hi      = last >> vec->kind->shift;
+  long long missing = 0;
+  size_t    bytes   = 0;
+
+  for (long long p = lo; p <= hi && missing < limit; p++) {
+    if (p >= vec->npages || ! vec->dir[p] || atomic_load(&vec->dir[p]->refs) > 1)
+      missing++;
+  }
+
+  if (hi >= vec->npages)
+    bytes += (size_t) ((hi >= 2LL * vec->npages) ? hi + 1 : 2LL * vec->npages) * sizeof(page_t*);
+
+  return bytes + (size_t) missing * page_bytes(vec->kind);
+}
+
+/** Return the bytes of a Bloom filter sized for <code>symbols</code> symbols */
+static size_t bloom_bytes (long long symbols, int bits_per_symbol) {
+  return pvec_bytes(&bloom_pages, (symbols * bits_per_symbol + 511) / 512);
+}
+
+/** Return the number of bytes a name takes outside its node, at most */
+static size_t long_name_bytes (const char* name) {
+  size_t len = strlen(name);
+  return (len < NAME_INLINE) ? 0 : len + 2;
+}
+
+/** Return the most memory that adding <code>symbols</code> symbols, whose
+ *  long names take <code>name_bytes</code> bytes in all, could allocate: the
+ *  pages their nodes, list heads, places in order, addresses and filter bits
+ *  land in, or
+ *  copies of them if they are shared with a snapshot, the growth of the
+ *  address table, filter and page directories, and the names.
+ *  @param index - the hash table index of the one symbol added, or -1
+ *  @param addr - the address of the one symbol added, if index is not -1
+ */
+static size_t add_reserve (const sym_table_t* symTab, long long symbols, size_t name_bytes,
+                           int index, int addr) {
+  const pvec_t* hash  = &symTab->hash_table;
+  const pvec_t* addrs = &symTab->addr_table;
+  size_t        bytes = pvec_reserve(&symTab->nodes, symTab->count,
+                                     symTab->count + symbols - 1, symbols);
+
+  bytes += pvec_reserve(&symTab->order, symTab->order_len, symTab->order_len + symbols - 1,
+                        symbols);
+  bytes += pvec_reserve(&symTab->place, symTab->count, symTab->count + symbols - 1, symbols);
+
+  if (index >= 0)
+    bytes += pvec_reserve(hash, index, index, 1);
+  else
+    bytes += pvec_reserve(hash, 0, symTab->size - 1, symbols);
+
+  if (symTab->addr_slot_bits) {
+    long long used = symTab->addr_used + symbols;
+    int       bits = symTab->addr_slot_bits;
+
+    while (4 * used > 3LL << bits)
+      bits++;
+
+    //growing allocates the new table before freeing the old one
+    if (bits > symTab->addr_slot_bits)
+      bytes += 2 * pvec_bytes(&addr_slot_pages, 1LL << bits);
+    else
+      bytes += pvec_reserve(addrs, 0, (1LL << bits) - 1, symbols);
+  }
+  else if (index < 0)
+    bytes += pvec_reserve(addrs, 0, symTab->addr_limit - 1, symbols);
+  else if ((unsigned) addr < symTab->addr_limit)
+    bytes += pvec_reserve(addrs, (unsigned) addr, (unsigned) addr, 1);
+
+  if (symTab->bloom_blocks) {
+    long long live = symTab->live + symbols;
+
+    if (live * symTab->bloom_bits > symTab->bloom_blocks * 512LL)
+      bytes += bloom_bytes(2 * live, symTab->bloom_bits);
+    else
+      bytes += pvec_reserve(&symTab->bloom, 0, symTab->bloom_blocks - 1, symbols);
+  }
+
+  //a page of the name store wastes less than the longest entry at its end
+  if (symTab->pack_names && name_bytes)
+    bytes += pvec_reserve(&symTab->names, symTab->names_brk,
+                          symTab->names_brk + 2 * name_bytes + (1 << NAMES_SHIFT),
+                          (name_bytes >> (NAMES_SHIFT - 1)) + 2);
+  else
+    bytes += name_bytes;
+
+  return bytes;
+}
+
+/** Is <code>node</code> named <code>name</code>? The hash, length and prefix
+ *  are those of <code>name</code>.
+ */
+static inline int node_is (const sym_table_t* symTab, node_t* node, const char* name,
+                           int hash, unsigned char len, uint64_t prefix) {
+  return hash == node->hash && len == node->len && prefix == node->prefix &&
+         (len <= NAME_PREFIX ||
+          (name_is_packed(node) ? name_packed_is(symTab, node, name) :
+           strcasecmp(name + NAME_PREFIX, node_name(symTab, node) + NAME_PREFIX) == 0));
+}
+
+/** Find the number of the node named <code>name</code> in the chain starting
+ *  at node <code>n</code>, or NIL. The hash, length and prefix stored in the
+ *  node settle almost every comparison; the name itself is only read past
+ *  the prefix when all three match. If <code>prev</code> is not NULL, it is
+ *  set to the number of the node before the match (NIL if the match is
+ *  <code>n</code>).
+ */
+static int chain_walk (sym_table_t* symTab, const char* name, int hash,
+                       unsigned char len, uint64_t prefix, int n, int* prev) {
+  if (prev)
+    *prev = NIL;
+
+  while (n != NIL) {
+    node_t* curr = node_at(symTab, n);
+
+    if (node_is(symTab, curr, name, hash, len, prefix))
+      return n;
+
+    if (prev)
+      *prev = n;
+
+    n = curr->next;
+  }
+
+  return NIL;
+}
+
+/** Find the number of the node named <code>name</code> in bucket
+ *  <code>index</code>, or NIL, as <code>chain_walk()</code> does.
+ */
+static inline int chain_find (sym_table_t* symTab, const char* name, int hash, int index, int* prev) {
+  return chain_walk(symTab, name, hash, name_len(name), name_prefix(name),
+                    bucket_head(symTab, index), prev);
+}
+
+/** Like <code>chain_find()</code>, but consult the table's Bloom filter (if
+ *  any) before touching the list.
+ */
+static inline int node_find (sym_table_t* symTab, const char* name, int hash, int index, int* prev) {
+  if (! bloom_test(symTab, hash)) {
+    if (prev)
+      *prev = NIL;
+
+    return NIL;
+  }
+
+  return chain_find(symTab, name, hash, index, prev);
+}
+
+/** Counts the lookups of a thread that pass by a hot symbol cache out of
+ *  credit, so that every HOT_SAMPLE-th one probes it
+ */
+static _Thread_local unsigned hot_tick;
+
+/** Make a hot symbol cache slot naming node <code>n</code> with the given
+ *  hash value and hit count.
+ */
+static inline uint64_t hot_slot (int hash, int n, unsigned hits) {
+  return (uint64_t) hits << HOT_HITS_SHIFT | (uint64_t) (hash & HOT_TAG_MASK) << 32 | (uint32_t) n;
+}
+
+/** Like <code>node_find()</code>, but try the table's hot symbol cache (if
+ *  any) once the head of the list has failed to match. A symbol at the head
+ *  is found as fast without a hint, and a list of one holds nothing else, so
+ *  neither touches the cache. A slot is only a hint: the node it names is
+ *  checked like any other, so a slot left behind by a removal or a reset
+ *  simply fails to match. A hit raises the slot's count, and a node found
+ *  further down a list lowers it, taking the slot once it reaches zero; a
+ *  popular symbol thus keeps its slot against a stream of others. Slots are
+ *  read and written atomically, as readers of a table may run in parallel,
+ *  and a slot whose count is at its limit is not written at all.
+ *  <p>
+ *  The cache also keeps a score of whether it pays: a hit earns it
+ *  HOT_HIT_CREDIT, and a probe that misses costs it one. Once lookups have
+ *  spent its credit, as when they are spread evenly over a large table,
+ *  only one in HOT_SAMPLE probes it (and may take a slot), which costs next
+ *  to nothing and lets it earn its way back when lookups concentrate
+ *  again. The score is not written once it is at either limit.
+ */
+static int hot_find (sym_table_t* symTab, const char* name, int hash, int index) {
+  if (! symTab->hot)
+    return node_find(symTab, name, hash, index, NULL);
+
+  if (! bloom_test(symTab, hash))
+    return NIL;
+
+  int head = bucket_head(symTab, index);
+
+  if (head == NIL)
+    return NIL;
+
+  node_t*       node   = node_at(symTab, head);
+  unsigned char len    = name_len(name);
+  uint64_t      prefix = name_prefix(name);
+
+  if (node_is(symTab, node, name, hash, len, prefix))
+    return head;
+
+  if (node->next == NIL)
+    return NIL;
+
+  int score = atomic_load_explicit(&symTab->hot_score, memory_order_relaxed);
+
+  if (score <= 0 && ++hot_tick % HOT_SAMPLE)
+    return chain_walk(symTab, name, hash, len, prefix, node->next, NULL);
+
+  _Atomic uint64_t* slot = &symTab->hot[hash & symTab->hot_mask];
+  uint64_t          hint = atomic_load_explicit(slot, memory_order_relaxed);
+  unsigned          hits = hint >> HOT_HITS_SHIFT;
+  int               n    = (int) (uint32_t) hint;
+
+  if ((int) (hint >> 32 & HOT_TAG_MASK) == (hash & HOT_TAG_MASK) && n < symTab->count) {
+    node_t* hot = node_at(symTab, n);
+
+    if (hot && node_is(symTab, hot, name, hash, len, prefix)) {
+      if (hits < HOT_MAX_HITS)
+        atomic_store_explicit(slot, hot_slot(hash, n, hits + 1), memory_order_relaxed);
+      if (score < HOT_SCORE_MAX)
+        atomic_store_explicit(&symTab->hot_score, score + HOT_HIT_CREDIT, memory_order_relaxed);
+
+      return n;
+    }
+  }
+
+  if (score > 0)
+    atomic_store_explicit(&symTab->hot_score, score - 1, memory_order_relaxed);
+
+  n = chain_walk(symTab, name, hash, len, prefix, node->next, NULL);
+
+  if (n != NIL)
+    atomic_store_explicit(slot, hits ? hint - ((uint64_t) 1 << HOT_HITS_SHIFT)
+                                     : hot_slot(hash, n, 0), memory_order_relaxed);
+
+  return n;
+}
+
+/** Lock a shared table for reading or writing and load its counters from
+ *  the region. Does nothing for a private table.
+ */
+static void table_lock (sym_table_t* symTab, int write) {
+  shm_header_t* shm = symTab->shm;
+
+  if (! shm)
+    return;
+
+  if (write)
+    pthread_rwlock_wrlock(&shm->lock);
+  else
+    pthread_rwlock_rdlock(&shm->lock);
+
+  symTab->size      = shm->size;
+  symTab->hash_table.gen = symTab->nodes.gen = symTab->addr_table.gen = shm->gen;
+  symTab->order.gen = symTab->place.gen = shm->gen;
+  symTab->count     = shm->count;
+  symTab->live      = shm->live;
+  symTab->free_list = shm->free_list;
+  symTab->order_len = shm->order_len;
+}
+
+/** Release the lock taken by <code>table_lock()</code>, first storing the
+ *  counters of a table locked for writing.
+ */
+static void table_unlock (sym_table_t* symTab, int write) {
+  shm_header_t* shm = symTab->shm;
+
+  if (! shm)
+    return;
+
+  if (write) {
+    shm->gen       = symTab->nodes.gen;
+    shm->count     = symTab->count;
+    shm->live      = symTab->live;
+    shm->free_list = symTab->free_list;
+    shm->order_len = symTab->order_len;
+  }
+
+  pthread_rwlock_unlock(&shm->lock);
+}
+
+/** djb hash - found at http://www.cse.yorku.ca/~oz/hash.html
+ * tolower() call to make case insensitive.
+ */
+
+static int symbol_hash (const char* name) {
+  unsigned char* str  = (unsigned char*) name;
+  unsigned long  hash = 5381;
+  int c;
+
+  while ((c = *str++))
+    hash = ((hash << 5) + hash) + tolower(c); /* hash * 33 + c */
+
+  c = hash & 0x7FFFFFFF; /* keep 31 bits - avoid negative values */
+
+  return c;
+}
+
+/** @todo Implement this function */
+sym_table_t* symbol_init (int table_size) {
+  return symbol_init_width(table_size, LC3_ADDR_BITS);
+}
+
+sym_table_t* symbol_init_width (int table_size, int addr_bits) {
+  return symbol_init_ex(table_size, addr_bits, NULL, 0);
+}
+
+/** Set up the address table of a new table for addresses of
+ *  <code>addr_bits</code> bits.
+ *  @return 1 on success, 0 if the allocator failed
+ */
+static int addr_init (sym_table_t* symTab, int addr_bits) {
+  //the largest address is SYMBOL_NO_ADDR when addresses are 32 bits wide
+  symTab->addr_limit = (addr_bits >= 32) ? 0xFFFFFFFFu : 1u << addr_bits;
+  symTab->addr_used  = 0;
+
+  if (addr_bits <= ADDR_DENSE_BITS) {
+    symTab->addr_slot_bits = 0;
+    return pvec_init(&symTab->addr_table, &addr_pages, 1 << addr_bits, symTab->mem);
+  }
+
+  symTab->addr_slot_bits = ADDR_HASH_BITS;
+  return pvec_init(&symTab->addr_table, &addr_slot_pages, 1 << ADDR_HASH_BITS, symTab->mem);
+}
+
+sym_table_t* symbol_init_ex (int table_size, int addr_bits, const symbol_alloc_t* alloc,
+                             size_t budget) {
+  debug("symbol_init was called with table_size = %d, addr_bits = %d", table_size, addr_bits);
+  if (addr_bits < 1 || addr_bits > 32)
+    return NULL;
+
+  mem_t* mem = mem_new(alloc ? alloc : &heap, budget);
+
+  if (! mem)
+    return NULL;
+
+  sym_table_t* sym_tab = mem_alloc(mem, sizeof(sym_table_t), _Alignof(sym_table_t));
+
+  if (! sym_tab) {
+    mem_release(mem);
+    return NULL;
+  }
+
+  sym_tab->mem = mem;
+  int ok = pvec_init(&sym_tab->hash_table, &index_pages, table_size, mem);
+  ok &= pvec_init(&sym_tab->nodes, &node_pages, 1 << NODE_SHIFT, mem);
+  ok &= pvec_init(&sym_tab->order, &index_pages, 1, mem);
+  ok &= pvec_init(&sym_tab->place, &index_pages, 1, mem);
+  ok &= addr_init(sym_tab, addr_bits);
+  ok &= pvec_init(&sym_tab->names, &name_store_pages, 1, mem);
+  sym_tab->pack_names = 0;
+  sym_tab->names_brk = 0;
+  sym_tab->names_block = 0;
+  sym_tab->names_in_block = NAMES_BLOCK;
+  ok &= pvec_init(&sym_tab->bloom, &bloom_pages, 1, mem);
+  ok &= pvec_init(&sym_tab->views, &view_pages, 1, mem);
+  sym_tab->bloom_blocks = 0;
+  sym_tab->bloom_bits = 0;
+  sym_tab->hot = NULL;
+  sym_tab->hot_mask = 0;
+  atomic_init(&sym_tab->hot_score, 0);
+  sym_tab->shm = NULL;
+  sym_tab->size = table_size;
+  sym_tab->count = 0;
+  sym_tab->live = 0;
+  sym_tab->free_list = NIL;
+  sym_tab->order_len = 0;
+
+  //a table that cannot even start within its budget is not created
+  if (! ok || ! mem_room(mem, 0)) {
+    symbol_term(sym_tab);
+    return NULL;
+  }
+
+  return sym_tab;
+}
+
+void symbol_memory (sym_table_t* symTab, symbol_mem_t* mem) {
+  mem->live   = atomic_load_explicit(&symTab->mem->live, memory_order_relaxed);
+  mem->peak   = atomic_load_explicit(&symTab->mem->peak, memory_order_relaxed);
+  mem->budget = symTab->mem->budget;
+}
+
+/** Fill in node <code>n</code> and make it the head of the list at
+ *  <code>index</code>. The node still has to be linked at its address.
+ *  @return 1 on success, 0 if there is no room for the name
+ */
+static int node_fill (sym_table_t* symTab, int n, const char* name, int hash, int index, int addr) {
+  node_t* node = pvec_write(&symTab->nodes, n);
+
+  if (! node_set_name(symTab, node, name))
+    return 0;
+
+  int* head = pvec_write(&symTab->hash_table, index);
+  node->hash = hash;
+  node->symbol.addr = addr;
+  node->next = *head;
+  *head = n;
+  return 1;
+}
+
+/** Get a table ready to add a symbol with the given hash, index and address
+ *  without allocating anything but storage for its name: make writable the
+ *  node it will take, its list head, its place in insertion order, its filter
+ *  block and its place in the address table.
+ *  @return 1 on success, 0 if a shared table is full or the allocator
+ *  failed, leaving the table unchanged in content
+ */
+static int add_ready (sym_table_t* symTab, int hash, int index, int addr) {
+  int n = (symTab->free_list != NIL) ? symTab->free_list : symTab->count;
+
+  if (n == symTab->count && symTab->shm && n >= symTab->shm->max_symbols)
+    return 0;
+
+  return pvec_write(&symTab->nodes, n) && pvec_write(&symTab->hash_table, index) &&
+         order_ready(symTab, n, 1) && bloom_ready(symTab, hash, 1) &&
+         addr_link_ready(symTab, addr, 1);
+}
+
+/** Add a symbol whose hash and index are already known, without checking for
+ *  duplicates, and return the number of its node, or NIL if there is no
+ *  room for it.
+ */
+static int node_add (sym_table_t* symTab, const char* name, int hash, int index, int addr) {
+  //make sure of room for the worst case before changing anything
+  if (symTab->mem->budget &&
+      ! mem_room(symTab->mem, add_reserve(symTab, 1, long_name_bytes(name), index, addr)))
+    return NIL;
+
+  if (! add_ready(symTab, hash, index, addr))
+    return NIL;
+
+  int n = node_alloc(symTab);
+  debug("Hash: %d, index: %d, node: %d", hash, index, n);
+
+  if (n == NIL)
+    return NIL;
+
+  if (! node_fill(symTab, n, name, hash, index, addr)) {
+    node_unalloc(symTab, n);
+    return NIL;
+  }
+
+  bloom_insert(symTab, hash);
+  order_append(symTab, n);
+  debug("Node added to head of list");
+
+  addr_link(symTab, n);
+  debug("address added.\n symTab->addr_table[addr] : %d\n address: %d\n", addr_node(symTab, addr), addr);
+  return n;
+}
+
+/** @todo Implement this function */
+int symbol_add_unique (sym_table_t* symTab, const char* name, int addr) {
+  int hash = symbol_hash(name);
+  table_lock(symTab, 1);
+  int n = node_add(symTab, name, hash, hash % symTab->size, addr);
+  table_unlock(symTab, 1);
+  return (n == NIL) ? SYMBOL_NOMEM : 1;
+}
+
+/** @todo Implement this function */
+char* symbol_find_by_addr (sym_table_t* symTab, int addr) {
+  debug("find by address called");
+  table_lock(symTab, 0);
+  int n = addr_node(symTab, addr);
+  char* name = (n == NIL) ? NULL : node_name(symTab, node_at(symTab, n));
+  table_unlock(symTab, 0);
+  return name;
+}
+
+/** @todo Implement this function */
+void symbol_iterate (sym_table_t* symTab, iterate_fnc_t fnc, void* data) {
+  debug("iterator called successfully");
+  symbol_iter_t iter;
+  symbol_t*     sym;
+
+  table_lock(symTab, 0);
+  symbol_iter_part(symTab, &iter, 0, 1);
+  while ((sym = symbol_iter_next(&iter)) != NULL)
+	(*fnc)(sym, data);
+  table_unlock(symTab, 0);
+}
+
+void symbol_iter_begin (sym_table_t* symTab, symbol_iter_t* iter) {
+  //loads the current counters of a shared table
+  table_lock(symTab, 0);
+  symbol_iter_part(symTab, iter, 0, 1);
+  table_unlock(symTab, 0);
+}
 
-#include "Debug.h"
-#include "symbol.h"
+void symbol_iter_part (sym_table_t* symTab, symbol_iter_t* iter, int part, int nparts) {
+  iter->symTab = symTab;
+  iter->pos    = (int) ((long long) symTab->order_len * part / nparts);
+  iter->end    = (int) ((long long) symTab->order_len * (part + 1) / nparts);
+}
 
-/** @file symbol.c
- *  @brief You will modify this file and implement the symbol.h interface
- *  @details Your implementation of the functions defined in symbol.h.
- *  You may add other functions if you find it helpful. Added functions
- *  should be declared <b>static</b> to indicate they are only used
- *  within this file.
- * <p>
- * @author <b>Your name</b> goes here
- */
+symbol_t* symbol_iter_next (symbol_iter_t* iter) {
+  while (iter->pos < iter->end) {
+    int       n   = order_node(iter->symTab, iter->pos++);
+    symbol_t* sym = (n == NIL) ? NULL : node_symbol(iter->symTab, n);
 
-/** size of LC3 memory */
-#define LC3_MEMORY_SIZE  (1 << 16)
+    //a symbol whose name cannot be decoded is skipped
+    if (sym)
+      return sym;
+  }
+
+  return NULL;
+}
 
-/** Provide prototype for strdup() */
-char *strdup(const char *s);
+/** Thread body of <code>symbol_iterate_parallel()</code> */
+static void* iterate_worker (void* arg) {
+  worker_t* w = arg;
+  symbol_t* sym;
 
-/** Defines the data structure used to store nodes in the hash table */
-typedef struct node {
-  struct node* next;     /**< linked list of symbols at same index */
-  int          hash;     /**< hash value - makes searching faster  */
-  symbol_t     symbol;   /**< the data the user is interested in   */
-} node_t;
+  while ((sym = symbol_iter_next(&w->iter)) != NULL)
+    (*w->fnc)(sym, w->data);
 
-/** Defines the data structure for the symbol table */
-struct sym_table {
-  int      size;        /**< size of hash table          */
-  node_t** hash_table;  /**< array of node_t pointers    */
-  char**   addr_table;  /**< array of character pointers */
-};
+  return NULL;
+}
 
-/** djb hash - found at http://www.cse.yorku.ca/~oz/hash.html
- * tolower() call to make case insensitive.
+/** Run <code>body</code> on each of <code>nthreads</code> arguments, each
+ *  <code>size</code> bytes long, in parallel. The calling thread runs the
+ *  first one itself, and any whose thread fails to start, or all of them if
+ *  there is no memory to keep track of threads.
  */
+static void run_parallel (mem_t* mem, int nthreads, void* (*body) (void*), void* args,
+                          size_t size) {
+  pthread_t* threads = mem_calloc(mem, nthreads, sizeof(pthread_t));
+  int*       started = mem_calloc(mem, nthreads, sizeof(int));
 
-static int symbol_hash (const char* name) {
-  unsigned char* str  = (unsigned char*) name;
-  unsigned long  hash = 5381;
-  int c;
+  if (! threads || ! started) {
+    for (int i = 0; i < nthreads; i++)
+      body((char*) args + i * size);
 
-  while ((c = *str++))
-    hash = ((hash << 5) + hash) + tolower(c); /* hash * 33 + c */
+    mem_free(mem, started, nthreads * sizeof(int));
+    mem_free(mem, threads, nthreads * sizeof(pthread_t));
+    return;
+  }
 
-  c = hash & 0x7FFFFFFF; /* keep 31 bits - avoid negative values */
+  for (int i = 1; i < nthreads; i++)
+    started[i] = (pthread_create(&threads[i], NULL, body, (char*) args + i * size) == 0);
 
-  return c;
-}
+  for (int i = 0; i < nthreads; i++) {
+    if (! started[i])
+      body((char*) args + i * size);
+  }
 
-/** @todo Implement this function */
-sym_table_t* symbol_init (int table_size) {
-  debug("symbol_init was called with table_size = %d", table_size);
-  sym_table_t* sym_tab = malloc(sizeof(sym_table_t));
-  sym_tab->hash_table = calloc(table_size, sizeof(node_t*));
-  sym_tab->addr_table = calloc(LC3_MEMORY_SIZE, sizeof(char*));
-  sym_tab->size = table_size;
-  return sym_tab;
+  for (int i = 1; i < nthreads; i++) {
+    if (started[i])
+      pthread_join(threads[i], NULL);
+  }
+
+  mem_free(mem, started, nthreads * sizeof(int));
+  mem_free(mem, threads, nthreads * sizeof(pthread_t));
 }
 
-/** @todo Implement this function */
-void symbol_add_unique (sym_table_t* symTab, const char* name, int addr) {
-  int hash = symbol_hash(name);
-  int index = hash % symTab->size;
-  //char* newName = strdup(name);
-  debug("Hash: %d, index: %d", hash, index);
-  node_t* node = calloc(1, sizeof(node_t));
-  symbol_t symbol;
+int symbol_iterate_parallel (sym_table_t* symTab, int nthreads, iterate_fnc_t fnc, void* data[]) {
+  debug("parallel iterate with %d threads", nthreads);
+  table_lock(symTab, 0);
+  if (nthreads > symTab->order_len)
+    nthreads = symTab->order_len;
+  if (nthreads < 1)
+    nthreads = 1;
 
-  debug("Symbol and node created");
+  //the workers of a shared table would map pages as they went; map every
+  //page first (its views were all allocated when it was opened)
+  for (int i = 0; symTab->shm && i < symTab->count; i += (1 << NODE_SHIFT))
+    pvec_read(&symTab->nodes, i);
+  for (int i = 0; symTab->shm && i < symTab->order_len; i += (1 << BUCKET_SHIFT))
+    pvec_read(&symTab->order, i);
 
-  symbol.name = strdup(name);//newName;
-  symbol.addr = addr;
-  node->next = NULL;
-  node->hash = hash;
-  node->symbol = symbol;
+  worker_t  one;
+  worker_t* workers = mem_calloc(symTab->mem, nthreads, sizeof(worker_t));
 
-  debug("Symbol and node initialized");
-  
-  if(symTab->hash_table[index] == NULL){
-	debug("Index is empty, prepare to add node");
-  	symTab->hash_table[index] = node;
-	debug("Node added to head of list");
+  //without memory for the workers, the calling thread does all the work
+  if (! workers) {
+    workers  = &one;
+    nthreads = 1;
   }
-  else{ 
-	debug("Index not empty, prepare to insert node");
-	node->next = symTab->hash_table[index];
-	symTab->hash_table[index] = node;
-	debug("Node added to head of list. Connected to next node");
+
+  for (int i = 0; i < nthreads; i++) {
+    symbol_iter_part(symTab, &workers[i].iter, i, nthreads);
+    workers[i].fnc  = fnc;
+    workers[i].data = data[i];
   }
-  debug("adding address to addr_table");
-  if(symTab->addr_table[addr]==NULL)
-  	symTab->addr_table[addr] = symbol.name; 
-  debug("address added.\n symTab->addr_table[addr] : %s\n address: %d\n", symTab->addr_table[addr], addr); 
 
+  run_parallel(symTab->mem, nthreads, iterate_worker, workers, sizeof(worker_t));
+  table_unlock(symTab, 0);
+
+  if (workers != &one)
+    mem_free(symTab->mem, workers, nthreads * sizeof(worker_t));
+
+  return nthreads;
 }
 
-/** @todo Implement this function */
-char* symbol_find_by_addr (sym_table_t* symTab, int addr) {
-  debug("find by address called");
-  debug("expected return value: %s\n", symTab->addr_table[addr]);
-  return symTab->addr_table[addr];
+/** Thread body of <code>symbol_merge()</code>. The worker visits every
+ *  source symbol in insertion order, but only handles those that hash into
+ *  its own range of indices, so it is the only writer of those lists and of
+ *  the nodes it adds to them.
+ */
+static void* merge_worker (void* arg) {
+  merge_worker_t* w   = arg;
+  sym_table_t*    dst = w->dst;
+
+  for (int s = 0; s < w->nsrcs; s++) {
+    sym_table_t* src = w->srcs[s];
+
+    for (int pos = 0; pos < src->order_len; pos++) {
+      int j = order_node(src, pos);
+
+      if (j == NIL)
+        continue;
+
+      node_t* node  = node_at(src, j);
+      int     index = node->hash % dst->size;
+
+      if (index < w->lo || index >= w->hi)
+        continue;
+
+      //names are decoded into the worker's own buffer, as the workers
+      //read the sources at once
+      char  buf[NAME_LONG];
+      char* name = buf;
+
+      if (name_is_packed(node))
+        name_unpack(src, node, buf);
+      else
+        name = node_name(src, node);
+
+      int existing = chain_find(dst, name, node->hash, index, NULL);
+
+      //a symbol whose name cannot be stored fails the whole merge
+      if (existing == NIL) {
+        if (! node_fill(dst, w->base[s] + pos, name, node->hash, index, node->symbol.addr)) {
+          w->failed = 1;
+          return NULL;
+        }
+
+        w->added++;
+        continue;
+      }
+
+      if (w->ndups == w->maxdups) {
+        int          max  = w->maxdups ? 2 * w->maxdups : 16;
+        merge_dup_t* dups = mem_calloc(dst->mem, max, sizeof(merge_dup_t));
+
+        if (! dups) {
+          w->failed = 1;
+          return NULL;
+        }
+
+        if (w->ndups)
+          memcpy(dups, w->dups, w->ndups * sizeof(merge_dup_t));
+
+        mem_free(dst->mem, w->dups, w->maxdups * sizeof(merge_dup_t));
+        w->dups    = dups;
+        w->maxdups = max;
+      }
+
+      w->dups[w->ndups++] = (merge_dup_t) { s, pos, j, existing };
+    }
+  }
+
+  return NULL;
 }
 
-/** @todo Implement this function */
-void symbol_iterate (sym_table_t* symTab, iterate_fnc_t fnc, void* data) {
-  debug("iterator called successfully");
-  for(int i = 0; i < symTab->size; i++){
-	node_t* curr = symTab->hash_table[i];
-	while(curr!=NULL){
-		(*fnc)(&(curr->symbol), data);
-		curr = curr->next;
-	}
+/** Order duplicates by source table, then by position within the source */
+static int merge_dup_cmp (const void* a, const void* b) {
+  const merge_dup_t* x = a;
+  const merge_dup_t* y = b;
+
+  if (x->src != y->src)
+    return x->src - y->src;
+
+  return x->pos - y->pos;
+}
+
+/** Take back the symbols that the workers of a failed merge added to
+ *  <code>dst</code> in nodes <code>first</code> to <code>last</code> - 1.
+ *  They are at the heads of their lists, ahead of every symbol that was
+ *  there before.
+ */
+static void merge_undo (sym_table_t* dst, int first, int last) {
+  for (int index = 0; index < dst->size; index++) {
+    int head = bucket_head(dst, index);
+    int n    = head;
+
+    while (n != NIL && n >= first) {
+      node_t* node = pvec_write(&dst->nodes, n);
+      n = node->next;
+      node_free_name(dst, node);
+    }
+
+    if (n != head)
+      *(int*) pvec_write(&dst->hash_table, index) = n;
+  }
+
+  for (int i = first; i < last; i++)
+    ((node_t*) pvec_write(&dst->nodes, i))->hash = NIL;
+}
+
+int symbol_merge (sym_table_t* dst, sym_table_t* srcs[], int n, int nthreads,
+                  conflict_fnc_t conflict, void* data) {
+  debug("merging %d tables with %d threads", n, nthreads);
+  for (int s = 0; s < n; s++) {
+    if (srcs[s]->shm)
+      return -1;
+  }
+
+  if (dst->shm)
+    return -1;
+
+  int* base  = mem_calloc(dst->mem, n + 1, sizeof(int));
+  int  first = dst->count;
+  int  ndups = 0;
+
+  if (! base)
+    return -1;
+
+  //the symbol at position p of source s becomes node base[s] + p, so the
+  //merged symbols keep the order of their sources; duplicates and the gaps of
+  //removed symbols leave holes that go on the free list
+  base[0] = first;
+  for (int s = 0; s < n; s++)
+    base[s + 1] = base[s] + srcs[s]->order_len;
+
+  //merge all or nothing: every page written below must fit in the budget
+  if (dst->mem->budget) {
+    size_t name_bytes = 0;
+
+    for (int s = 0; s < n; s++) {
+      for (int j = 0; j < srcs[s]->count; j++) {
+        node_t* node = node_at(srcs[s], j);
+
+        if (node_used(node) && name_is_long(node))
+          name_bytes += 2 + ((node->len < NAME_LONG) ? node->len
+                                                     : strlen(node_name(srcs[s], node)));
+      }
+    }
+
+    //the hash table is made private in full before the workers start
+    if (! mem_room(dst->mem, add_reserve(dst, base[n] - first, name_bytes, -1, 0) +
+                             pvec_reserve(&dst->hash_table, 0, dst->size - 1, dst->size))) {
+      mem_free(dst->mem, base, (n + 1) * sizeof(int));
+      return -1;
+    }
+  }
+
+  //make every page written below private before the workers start, so no
+  //worker ever has to allocate or copy a page and linking cannot fail, and
+  //mark the nodes free until a worker fills them
+  int ready = 1;
+
+  for (int i = first; ready && i < base[n]; i++) {
+    node_t* node = pvec_write(&dst->nodes, i);
+
+    if (node)
+      node->hash = NIL;
+    else
+      ready = 0;
+  }
+
+  ready = ready && pvec_ready(&dst->hash_table, 0, dst->size - 1) &&
+          order_ready(dst, first, base[n] - first) && bloom_ready(dst, NIL, base[n] - first);
+
+  for (int s = 0; ready && s < n; s++) {
+    for (int j = 0; ready && j < srcs[s]->count; j++) {
+      node_t* node = node_at(srcs[s], j);
+
+      if (node_used(node))
+        ready = addr_link_ready(dst, node->symbol.addr, base[n] - first);
+    }
+  }
+
+  //the symbols linked first lengthen the runs later ones are probed along
+  if (ready && dst->addr_slot_bits)
+    ready = pvec_ready(&dst->addr_table, 0, (1 << dst->addr_slot_bits) - 1);
+
+  //every name added to a name store is coded against the one before it
+  if (nthreads > dst->size || dst->pack_names)
+    nthreads = dst->pack_names ? 1 : dst->size;
+  if (nthreads < 1)
+    nthreads = 1;
+
+  merge_worker_t* workers = ready ? mem_calloc(dst->mem, nthreads, sizeof(merge_worker_t)) : NULL;
+
+  if (! workers) {
+    mem_free(dst->mem, base, (n + 1) * sizeof(int));
+    return -1;
+  }
+
+  unsigned names_brk = dst->names_brk;
+
+  for (int t = 0; t < nthreads; t++) {
+    workers[t].dst   = dst;
+    workers[t].srcs  = srcs;
+    workers[t].base  = base;
+    workers[t].nsrcs = n;
+    workers[t].lo    = (int) ((long long) dst->size * t / nthreads);
+    workers[t].hi    = (int) ((long long) dst->size * (t + 1) / nthreads);
+  }
+
+  run_parallel(dst->mem, nthreads, merge_worker, workers, sizeof(merge_worker_t));
+
+  int failed = 0;
+
+  for (int t = 0; t < nthreads; t++) {
+    failed |= workers[t].failed;
+    ndups  += workers[t].ndups;
+  }
+
+  //report the duplicates in source order, whichever worker found them
+  int          maxdups = ndups + 1;
+  merge_dup_t* dups    = failed ? NULL : mem_calloc(dst->mem, maxdups, sizeof(merge_dup_t));
+
+  if (dups) {
+    ndups = 0;
+
+    for (int t = 0; t < nthreads; t++) {
+      if (workers[t].ndups)
+        memcpy(dups + ndups, workers[t].dups, workers[t].ndups * sizeof(merge_dup_t));
+
+      ndups += workers[t].ndups;
+    }
+
+    qsort(dups, ndups, sizeof(merge_dup_t), merge_dup_cmp);
+
+    //decode the names of the symbols handed to the callback while the merge
+    //can still be undone; the pages of their nodes are not copied again
+    for (int i = 0; conflict && i < ndups; i++) {
+      if (! node_symbol(dst, dups[i].existing) ||
+          ! node_symbol(srcs[dups[i].src], dups[i].node)) {
+        mem_free(dst->mem, dups, maxdups * sizeof(merge_dup_t));
+        dups = NULL;
+        break;
+      }
+    }
+  }
+
+  for (int t = 0; t < nthreads; t++)
+    mem_free(dst->mem, workers[t].dups, workers[t].maxdups * sizeof(merge_dup_t));
+
+  if (! dups) {
+    merge_undo(dst, first, base[n]);
+
+    //the names packed by the workers are given up, and the next one starts
+    //a block of its own
+    if (dst->names_brk != names_brk) {
+      dst->names_brk      = names_brk;
+      dst->names_in_block = NAMES_BLOCK;
+    }
+
+    mem_free(dst->mem, workers, nthreads * sizeof(merge_worker_t));
+    mem_free(dst->mem, base, (n + 1) * sizeof(int));
+    return -1;
   }
+
+  dst->count = base[n];
+  for (int t = 0; t < nthreads; t++)
+    dst->live += workers[t].added;
+
+  //link the new symbols at their addresses and in insertion order, and free
+  //the holes from the highest so that the lowest is reused first
+  for (int i = first; i < base[n]; i++) {
+    if (node_used(node_at(dst, i))) {
+      addr_link(dst, i);
+      bloom_insert(dst, node_at(dst, i)->hash);
+      order_append(dst, i);
+    }
+  }
+
+  for (int i = base[n] - 1; i >= first; i--) {
+    if (! node_used(node_at(dst, i))) {
+      ((node_t*) pvec_write(&dst->nodes, i))->next = dst->free_list;
+      dst->free_list = i;
+    }
+  }
+
+  for (int i = 0; conflict && i < ndups; i++)
+    (*conflict)(node_symbol(dst, dups[i].existing),
+                node_symbol(srcs[dups[i].src], dups[i].node), dups[i].src, data);
+
+  debug("merge added %d symbols, %d duplicates", base[n] - first - ndups, ndups);
+  mem_free(dst->mem, dups, maxdups * sizeof(merge_dup_t));
+  mem_free(dst->mem, workers, nthreads * sizeof(merge_worker_t));
+  mem_free(dst->mem, base, (n + 1) * sizeof(int));
+  return ndups;
 }
 
 /** @todo Implement this function */
 struct node* symbol_search (sym_table_t* symTab, const char* name, int* ptrToHash, int* ptrToIndex) {
   debug("Symbol search successfully called");
   *ptrToHash = symbol_hash(name);
+  table_lock(symTab, 0);
   *ptrToIndex = *ptrToHash%(symTab->size);
   debug("Check initialization. *ptrToHash:%d *ptrToIndex:%d name:%s", *ptrToHash, *ptrToIndex, name);
 
-  node_t* curr = symTab->hash_table[*ptrToIndex];
-  debug("Iterating linked list at index: %d", *ptrToIndex);
-  while(curr!=NULL){
-	if(*ptrToHash==curr->hash && strcasecmp(strdup(name), curr->symbol.name)==0){
-		debug("symbol found, function terminated\n");
-		return curr;
-	}
-	else	
-		curr = curr->next;
-	
-  }
-  debug("symbol NOT currently in table\n");
-  return NULL;
+  int n = hot_find(symTab, name, *ptrToHash, *ptrToIndex);
+  debug("symbol %s in table\n", (n == NIL) ? "NOT currently" : "found");
+  node_t* node = (n == NIL) ? NULL : node_at(symTab, n);
+  table_unlock(symTab, 0);
+  return node;
 }
 
 /** @todo Implement this function */
 int symbol_add (sym_table_t* symTab, const char* name, int addr) {
   debug("symbol_add method successfully called");
+  int result = 0;
   int ptrToHash = symbol_hash(name);
+  table_lock(symTab, 1);
   int ptrToIndex = ptrToHash%(symTab->size);
 
-  if(symbol_search(symTab, name, &ptrToHash, &ptrToIndex)==NULL){
-	symbol_add_unique(symTab, name, addr);
-	debug("Symbol added\n");
-	return 1;
+  if(node_find(symTab, name, ptrToHash, ptrToIndex, NULL)==NIL){
+	result = (node_add(symTab, name, ptrToHash, ptrToIndex, addr) == NIL) ? SYMBOL_NOMEM : 1;
+	debug("Symbol added: %d\n", result);
   }else{
   	debug("Symbol NOT added\n");
-  	return 0;
   }
+
+  table_unlock(symTab, 1);
+  return result;
 }
 
 /** @todo Implement this function */
 symbol_t* symbol_find_by_name (sym_table_t* symTab, const char* name) {
   debug("symbol_find_by_name successfully called\n");
   int ptrToHash = symbol_hash(name);
+  table_lock(symTab, 0);
   int ptrToIndex = ptrToHash%(symTab->size);
-  node_t* symNode = symbol_search(symTab, name, &ptrToHash, &ptrToIndex);
+  int n = hot_find(symTab, name, ptrToHash, ptrToIndex);
+  symbol_t* sym = (n == NIL) ? NULL : node_symbol(symTab, n);
+  table_unlock(symTab, 0);
+  return sym;
+}
 
-  if(symNode==NULL)
-  	return NULL;
-  else
-	return &(symNode->symbol);
+/** Move node <code>n</code> to address <code>addr</code>
+ *  @return 1 on success, <code>SYMBOL_NOMEM</code> if the allocator failed,
+ *  leaving the node where it was
+ */
+static int node_move (sym_table_t* symTab, int n, int addr) {
+  //growing the address table makes it private in full, so it goes first
+  if (! addr_link_ready(symTab, addr, 1) || ! addr_unlink_ready(symTab, n) ||
+      ! pvec_write(&symTab->nodes, n))
+    return SYMBOL_NOMEM;
+
+  addr_unlink(symTab, n);
+  ((node_t*) pvec_write(&symTab->nodes, n))->symbol.addr = addr;
+  addr_link(symTab, n);
+  return 1;
+}
+
+int symbol_update (sym_table_t* symTab, const char* name, int addr) {
+  debug("symbol_update called for %s", name);
+  int hash = symbol_hash(name);
+  table_lock(symTab, 1);
+  int n = node_find(symTab, name, hash, hash % symTab->size, NULL);
+  int result = (n == NIL) ? 0 : node_move(symTab, n, addr);
+  table_unlock(symTab, 1);
+  return result;
+}
+
+int symbol_intern (sym_table_t* symTab, const char* name) {
+  int hash = symbol_hash(name);
+  table_lock(symTab, 1);
+  int index = hash % symTab->size;
+  int n = node_find(symTab, name, hash, index, NULL);
+
+  if (n == NIL)
+    n = node_add(symTab, name, hash, index, SYMBOL_NO_ADDR);
+
+  table_unlock(symTab, 1);
+  debug("%s interned as %d", name, n);
+  return (n == NIL) ? SYMBOL_NOMEM : n;
+}
+
+/** Return the node of symbol <code>id</code>, or NULL if there is none */
+static inline node_t* node_by_id (sym_table_t* symTab, int id) {
+  node_t* node = ((unsigned) id < (unsigned) symTab->count) ? node_at(symTab, id) : NULL;
+  return (node && node_used(node)) ? node : NULL;
+}
+
+char* symbol_name (sym_table_t* symTab, int id) {
+  table_lock(symTab, 0);
+  node_t* node = node_by_id(symTab, id);
+  char* name = node ? node_name(symTab, node) : NULL;
+  table_unlock(symTab, 0);
+  return name;
+}
+
+int symbol_get_addr (sym_table_t* symTab, int id) {
+  table_lock(symTab, 0);
+  node_t* node = node_by_id(symTab, id);
+  int addr = node ? node->symbol.addr : SYMBOL_NO_ADDR;
+  table_unlock(symTab, 0);
+  return addr;
+}
+
+int symbol_set_addr (sym_table_t* symTab, int id, int addr) {
+  table_lock(symTab, 1);
+  node_t* node   = node_by_id(symTab, id);
+  int     result = (node != NULL);
+
+  if (node && node->symbol.addr != addr)
+    result = node_move(symTab, id, addr);
+
+  table_unlock(symTab, 1);
+  return result;
+}
+
+int symbol_remove (sym_table_t* symTab, const char* name) {
+  debug("symbol_remove called for %s", name);
+  int hash = symbol_hash(name);
+  int prev;
+  table_lock(symTab, 1);
+  int index = hash % symTab->size;
+  int n = node_find(symTab, name, hash, index, &prev);
+
+  //make every page written below writable before changing anything
+  if (n != NIL && (! pvec_write(&symTab->nodes, n) || ! addr_unlink_ready(symTab, n) ||
+                   ! order_entry(symTab, n) ||
+                   ! ((prev == NIL) ? pvec_write(&symTab->hash_table, index)
+                                    : pvec_write(&symTab->nodes, prev)))) {
+    table_unlock(symTab, 1);
+    return SYMBOL_NOMEM;
+  }
+
+  if (n != NIL) {
+    addr_unlink(symTab, n);
+
+    node_t* node = pvec_write(&symTab->nodes, n);
+    int*    link = (prev == NIL) ? pvec_write(&symTab->hash_table, index)
+                                 : &((node_t*) pvec_write(&symTab->nodes, prev))->next;
+    *link = node->next;
+
+    *order_entry(symTab, n) = NIL;
+    node_free_name(symTab, node);
+    node_unalloc(symTab, n);
+    order_compact(symTab);
+    debug("node %d unlinked and freed", n);
+  }
+
+  table_unlock(symTab, 1);
+  return n != NIL;
+}
+
+void symbol_bloom (sym_table_t* symTab, int bits_per_symbol) {
+  debug("Bloom filter with %d bits per symbol", bits_per_symbol);
+  if (symTab->shm)
+    return;
+
+  int symbols = (symTab->live > symTab->size) ? symTab->live : symTab->size;
+  symTab->bloom_bits = bits_per_symbol;
+
+  //a filter that would not fit in the budget, or cannot be allocated, is
+  //not built, and the old one, sized for other settings, is dropped
+  if (bits_per_symbol <= 0 || ! mem_room(symTab->mem, bloom_bytes(symbols, bits_per_symbol)) ||
+      ! bloom_build(symTab, symbols)) {
+    pvec_clear(&symTab->bloom);
+    symTab->bloom_blocks = 0;
+  }
+}
+
+void symbol_compress_names (sym_table_t* symTab, int enable) {
+  debug("compressed names %s", enable ? "on" : "off");
+  if (! symTab->shm)
+    symTab->pack_names = enable;
+}
+
+void symbol_hot_cache (sym_table_t* symTab, int slots) {
+  debug("hot symbol cache of %d slots", slots);
+  if (symTab->hot)
+    mem_free(symTab->mem, symTab->hot, (symTab->hot_mask + 1) * sizeof(symTab->hot[0]));
+
+  symTab->hot      = NULL;
+  symTab->hot_mask = 0;
+
+  if (slots <= 0)
+    return;
+
+  int n = 1;
+
+  while (n < slots && n < HOT_MAX_SLOTS)
+    n *= 2;
+
+  if (! mem_room(symTab->mem, n * sizeof(symTab->hot[0])))
+    return;
+
+  //an empty slot names node 0, and is checked like any other
+  symTab->hot = mem_calloc(symTab->mem, n, sizeof(symTab->hot[0]));
+
+  if (symTab->hot) {
+    symTab->hot_mask = n - 1;
+    atomic_store_explicit(&symTab->hot_score, HOT_SCORE_START, memory_order_relaxed);
+  }
+}
+
+symbol_t* symbol_find_in_tables (sym_table_t* tabs[], int n, const char* name, int* which) {
+  int  hash = symbol_hash(name);
+  int  cand[FIND_BATCH];
+  int  found = 0;
+  symbol_t* sym = NULL;
+
+  for (int first = 0; first < n && ! found; first += FIND_BATCH) {
+    int last  = (n - first < FIND_BATCH) ? n : first + FIND_BATCH;
+    int ncand = 0;
+
+    //rule out tables by their filters first, so that misses touch no lists
+    for (int t = first; t < last; t++) {
+      if (bloom_test(tabs[t], hash))
+        cand[ncand++] = t;
+    }
+
+    debug("%s: %d of tables %d-%d may define it", name, ncand, first, last - 1);
+
+    //the first table to define the name answers, even if its symbol
+    //cannot be returned
+    for (int i = 0; i < ncand && ! found; i++) {
+      sym_table_t* symTab = tabs[cand[i]];
+      table_lock(symTab, 0);
+      int m = chain_find(symTab, name, hash, hash % symTab->size, NULL);
+
+      if (m != NIL) {
+        sym   = node_symbol(symTab, m);
+        found = 1;
+
+        if (which)
+          *which = cand[i];
+      }
+
+      table_unlock(symTab, 0);
+    }
+  }
+
+  return sym;
+}
+
+sym_table_t* symbol_snapshot (sym_table_t* symTab) {
+  debug("snapshot of table with %d nodes", symTab->count);
+  if (symTab->shm)
+    return NULL;
+
+  size_t dirs = symTab->hash_table.npages + symTab->nodes.npages + symTab->order.npages +
+                symTab->place.npages + symTab->addr_table.npages + symTab->bloom.npages +
+                symTab->names.npages + 1;
+  size_t hot  = symTab->hot ? (symTab->hot_mask + 1) * sizeof(symTab->hot[0]) : 0;
+
+  if (! mem_room(symTab->mem, sizeof(sym_table_t) + dirs * sizeof(page_t*) + hot))
+    return NULL;
+
+  sym_table_t* snap = mem_alloc(symTab->mem, sizeof(sym_table_t), _Alignof(sym_table_t));
+
+  if (! snap)
+    return NULL;
+
+  *snap     = *symTab;
+  snap->hot = NULL;
+  atomic_fetch_add(&snap->mem->refs, 1);
+
+  //every array is set up, even after a failure, so the snapshot can be freed
+  int ok = pvec_share(&snap->hash_table, &symTab->hash_table);
+  ok &= pvec_share(&snap->nodes, &symTab->nodes);
+  ok &= pvec_share(&snap->order, &symTab->order);
+  ok &= pvec_share(&snap->place, &symTab->place);
+  ok &= pvec_share(&snap->addr_table, &symTab->addr_table);
+  ok &= pvec_share(&snap->bloom, &symTab->bloom);
+  ok &= pvec_share(&snap->names, &symTab->names);
+  ok &= pvec_init(&snap->views, &view_pages, 1, snap->mem);
+  symbol_hot_cache(snap, symTab->hot ? symTab->hot_mask + 1 : 0);
+
+  if (! ok || (symTab->hot && ! snap->hot)) {
+    symbol_term(snap);
+    return NULL;
+  }
+
+  return snap;
 }
 
 /** @todo Implement this function */
 void symbol_reset(sym_table_t* symTab) {
   debug("reset successfully called");
-  int count = 1;
-  
-  //loop to empty address table contents
-  debug("Setting addresses to NULL");
-  for(int i = 0; i < LC3_MEMORY_SIZE; i++){
-	symTab->addr_table[i] = NULL;
-  }
-
-  //loop to free hash_table symbols
-  for(int i = 0; i < symTab->size; i++){
-	node_t* curr = symTab->hash_table[i];
-	node_t* buff = NULL;
-	while(curr!=NULL){
-		debug("Freeing memory for node %d", count);
-		buff = curr;
-		curr = curr->next;
-		free(buff->symbol.name);// = NULL;
-		debug("Attempting to free node");
-		free(buff); buff = NULL;
-		debug("Node freed");
-		count++;
-	}
-	symTab->hash_table[i] = NULL;
+  table_lock(symTab, 1);
+
+  //the pages, and the names in them, are reclaimed as they are reused
+  pvec_retire(&symTab->addr_table);
+  pvec_retire(&symTab->hash_table);
+  pvec_retire(&symTab->nodes);
+  pvec_retire(&symTab->order);
+  pvec_retire(&symTab->place);
+  pvec_retire(&symTab->bloom);
+  pvec_retire(&symTab->names);
+  symTab->names_brk = 0;
+  symTab->names_in_block = NAMES_BLOCK;
+  symTab->addr_used = 0;
+  symTab->count = 0;
+  symTab->live = 0;
+  symTab->free_list = NIL;
+  symTab->order_len = 0;
+
+  if (symTab->shm) {
+    symTab->shm->name_brk = symTab->shm->name_base;
+    memset(symTab->shm->name_free, 0, sizeof(symTab->shm->name_free));
   }
 
+  table_unlock(symTab, 1);
   debug("reset successfully terminated\n");
 }
 
 /** @todo Implement this function */
 void symbol_term (sym_table_t* symTab) {
   debug("terminate successfully called");
-  symbol_reset(symTab); debug("symbol table reset");
-  free(symTab->hash_table); debug("hash_table freed");
-  free(symTab->addr_table); debug("address table freed");
-  free(symTab);
+  if (symTab->shm) {
+    munmap(symTab->shm, symTab->shm->bytes); /* other processes keep the table */
+  } else {
+    //dropping a page frees it and its names unless a snapshot still uses it
+    pvec_clear(&symTab->addr_table);
+    pvec_clear(&symTab->hash_table);
+    pvec_clear(&symTab->nodes);
+    pvec_clear(&symTab->order);
+    pvec_clear(&symTab->place);
+    pvec_clear(&symTab->bloom);
+    pvec_clear(&symTab->names);
+  }
+  debug("symbol table reset");
+  pvec_free(&symTab->hash_table); debug("hash_table freed");
+  pvec_free(&symTab->nodes);
+  pvec_free(&symTab->order);
+  pvec_free(&symTab->place);
+  pvec_free(&symTab->addr_table); debug("address table freed");
+  pvec_free(&symTab->bloom);
+  pvec_free(&symTab->names);
+  pvec_clear(&symTab->views);
+  pvec_free(&symTab->views);
+  symbol_hot_cache(symTab, 0);
+
+  mem_t* mem = symTab->mem;
+  mem_free(mem, symTab, sizeof(sym_table_t));
+  mem_release(mem);
   debug("symbol table successfully deconstructed. Terminating program\n");
 }
 
+/** Create the table structure through which this process uses a region */
+static sym_table_t* shm_table (shm_header_t* shm) {
+  mem_t*       mem    = mem_new(&heap, 0);
+  sym_table_t* symTab = mem ? mem_calloc(mem, 1, sizeof(sym_table_t)) : NULL;
+
+  if (! symTab) {
+    if (mem)
+      mem_release(mem);
+
+    munmap(shm, shm->bytes);
+    return NULL;
+  }
+
+  symTab->mem = mem;
+  symTab->shm = shm;
+  int ok = pvec_init_shm(&symTab->hash_table, &index_pages, shm, 0, mem);
+  ok &= pvec_init_shm(&symTab->nodes, &node_pages, shm, 1, mem);
+  ok &= pvec_init_shm(&symTab->addr_table, &addr_pages, shm, 2, mem);
+  ok &= pvec_init_shm(&symTab->order, &index_pages, shm, 3, mem);
+  ok &= pvec_init_shm(&symTab->place, &index_pages, shm, 4, mem);
+  symTab->addr_limit = LC3_MEMORY_SIZE;
+  ok &= pvec_init(&symTab->bloom, &bloom_pages, 1, mem);
+  ok &= pvec_init(&symTab->names, &name_store_pages, 1, mem);
+
+  //the views are all allocated now, so that lookups, which write them under
+  //a shared lock, never allocate
+  ok &= pvec_init(&symTab->views, &view_pages, shm->max_symbols, mem) &&
+        pvec_ready(&symTab->views, 0, shm->max_symbols - 1);
+
+  if (! ok) {
+    symbol_term(symTab);
+    return NULL;
+  }
+
+  table_lock(symTab, 0);
+  table_unlock(symTab, 0);
+  return symTab;
+}
+
+/** Round a region offset up to a multiple of a cache line */
+static size_t shm_align (size_t off) {
+  return (off + 63) & ~(size_t) 63;
+}
+
+sym_table_t* symbol_shm_create (const char* name, int table_size, int max_symbols) {
+  debug("creating shared table %s", name);
+  static const page_kind_t* kinds[SHM_ARRAYS] = {
+    &index_pages, &node_pages, &addr_pages, &index_pages, &index_pages
+  };
+  //removed symbols never leave more gaps in the insertion order than there
+  //are symbols, so it needs at most twice as many entries
+  int    counts[SHM_ARRAYS] = {
+    table_size, max_symbols, LC3_MEMORY_SIZE, 2 * max_symbols + 1, max_symbols
+  };
+  int    npages[SHM_ARRAYS];
+  size_t dirs[SHM_ARRAYS];
+  size_t off = shm_align(sizeof(shm_header_t));
+  size_t page_base, name_base;
+
+  //the header, then the page directories, then room for every page of every
+  //array, then the long names
+  for (int k = 0; k < SHM_ARRAYS; k++) {
+    npages[k] = ((counts[k] - 1) >> kinds[k]->shift) + 1;
+    dirs[k]   = off;
+    off       = shm_align(off + npages[k] * sizeof(size_t));
+  }
+
+  page_base = off;
+  for (int k = 0; k < SHM_ARRAYS; k++)
+    off += npages[k] * (sizeof(page_t) + (kinds[k]->elem_size << kinds[k]->shift));
+
+  name_base = off;
+  off      += (size_t) max_symbols * SHM_NAME_BYTES;
+
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+
+  if (fd < 0)
+    return NULL;
+
+  shm_header_t* shm = MAP_FAILED;
+
+  if (ftruncate(fd, off) == 0)
+    shm = mmap(NULL, off, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  close(fd);
+
+  if (shm == MAP_FAILED) {
+    shm_unlink(name);
+    return NULL;
+  }
+
+  pthread_rwlockattr_t attr;
+  pthread_rwlockattr_init(&attr);
+  pthread_rwlockattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_rwlock_init(&shm->lock, &attr);
+  pthread_rwlockattr_destroy(&attr);
+
+  shm->bytes       = off;
+  shm->page_brk    = page_base;
+  shm->page_end    = name_base;
+  shm->name_base   = name_base;
+  shm->name_brk    = name_base;
+  shm->name_end    = off;
+  memset(shm->name_free, 0, sizeof(shm->name_free));
+  shm->max_symbols = max_symbols;
+  shm->gen         = 0;
+  shm->size        = table_size;
+  shm->count       = 0;
+  shm->live        = 0;
+  shm->free_list   = NIL;
+  shm->order_len   = 0;
+
+  for (int k = 0; k < SHM_ARRAYS; k++) {
+    shm->dirs[k]   = dirs[k];
+    shm->npages[k] = npages[k];
+  }
+
+  shm->magic = SHM_MAGIC;
+  sym_table_t* symTab = shm_table(shm);
+
+  if (! symTab)
+    shm_unlink(name);
+
+  return symTab;
+}
+
+sym_table_t* symbol_shm_attach (const char* name) {
+  debug("attaching shared table %s", name);
+  struct stat st;
+  shm_header_t* shm = MAP_FAILED;
+  int fd = shm_open(name, O_RDWR, 0);
+
+  if (fd < 0)
+    return NULL;
+
+  if (fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(shm_header_t))
+    shm = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  close(fd);
+
+  if (shm == MAP_FAILED)
+    return NULL;
+
+  if (shm->magic != SHM_MAGIC || shm->bytes != (size_t) st.st_size) {
+    munmap(shm, st.st_size);
+    return NULL;
+  }
+
+  return shm_table(shm);
+}
+
+int symbol_shm_unlink (const char* name) {
+  return shm_unlink(name) == 0;
+}
@@ -1,6 +1,8 @@
 #ifndef __SYMBOL_H__
 #define __SYMBOL_H__
 
+#include <stddef.h>
+
 /*
  * "Copyright (c) 2014 by Fritz Sieker."
  *
@@ -40,7 +42,9 @@
 typedef struct sym_table sym_table_t;
 
 /** The symbol_find methods return a pointer to this data structure. It
-represents a (name, address) pair in the symbol table.
+represents a (name, address) pair in the symbol table. The name is owned by
+the table (short names are stored inside the table's node) and must not be
+modified or freed by the caller.
  */
 
 typedef struct symbol {
@@ -48,6 +52,23 @@ typedef struct symbol {
     int   addr; /**< symbol's address in the LC3 memory */
 } symbol_t;
 
+/** The address of a symbol created by <code>symbol_intern()</code> before
+ *  one is assigned with <code>symbol_set_addr()</code>. Symbols with this
+ *  address (or any address outside the LC3 memory) are not entered in the
+ *  address table.
+ */
+#define SYMBOL_NO_ADDR (-1)
+
+/** Returned by the functions that add symbols when there is no room for one
+ *  more, which can only happen with a table in shared memory (see
+ *  <code>symbol_shm_create()</code>), with a table whose memory budget would
+ *  not hold it (see <code>symbol_init_ex()</code>), or when the table's
+ *  allocator fails. The functions that move or remove a symbol return it
+ *  when the memory they need does not fit in the budget or the allocator
+ *  fails.
+ */
+#define SYMBOL_NOMEM (-1)
+
 /** Defines the signature of a callback function (also known as a function
  *  pointer). This is how languages such as Java and C++ do <b>dynamic</b>
  *  binding (i.e. figure out which function to call). Recall that in Java, the
@@ -67,6 +88,27 @@ typedef struct symbol {
  */
 typedef void (*iterate_fnc_t)(symbol_t* sym, void* data);
 
+/** Defines the signature of the function <code>symbol_merge()</code> calls for
+ *  each duplicate definition it finds.
+ *  @param existing - the definition that is kept in the destination table
+ *  @param duplicate - the definition that was not merged
+ *  @param src - index in the source array of the table holding
+ *  <code>duplicate</code>
+ *  @param data - a pointer to some data that the function might need.
+ */
+typedef void (*conflict_fnc_t)(symbol_t* existing, symbol_t* duplicate, int src, void* data);
+
+/** A cursor over the symbols of a table, used with
+ *  <code>symbol_iter_begin()</code> and <code>symbol_iter_next()</code>. It is
+ *  an ordinary value that the caller allocates (usually on the stack); its
+ *  members are private to <code>symbol.c</code>.
+ */
+typedef struct symbol_iter {
+  sym_table_t* symTab; /**< table being visited                     */
+  int          pos;    /**< place of the next symbol to return      */
+  int          end;    /**< place at which the cursor stops         */
+} symbol_iter_t;
+
 /** Create a new symbol table and return a pointer to it. This function is a
  *  constructor for a symbol table and is automatically called when the program
  *  starts. In this function, you must dynamically (i.e., using
@@ -104,6 +146,12 @@ typedef void (*iterate_fnc_t)(symbol_t* sym, void* data);
  * 
  *  Make sure you store <code>table_size</code> in the <code>size</code> member
  *  of the <code>sym_table_t</code> structure allocated previously.
+ *  <p>
+ *  In this implementation the hash table, the nodes and the address table
+ *  are each stored as a directory of fixed-size pages that are allocated the
+ *  first time they are written, and the tables hold node numbers rather than
+ *  pointers. This lets <code>symbol_snapshot()</code> share pages between
+ *  tables.
  * 
  *  @param table_size - The size of the hash table.
  *  @return A pointer to the <code>sym_table_t</code> structure you
@@ -112,6 +160,107 @@ typedef void (*iterate_fnc_t)(symbol_t* sym, void* data);
  */ 
 sym_table_t* symbol_init (int table_size);
 
+/** Create a new symbol table, like <code>symbol_init()</code>, for a machine
+ *  whose addresses are <code>addr_bits</code> bits wide rather than the 16
+ *  bits of the LC3. <code>symbol_init(size)</code> is the same as
+ *  <code>symbol_init_width(size, 16)</code>.
+ *  <p>
+ *  Addresses up to 16 bits wide are indexed by a dense address table, as
+ *  described for <code>symbol_init()</code>. A wider address space would make
+ *  that table far larger than the symbols in it (4G entries for 32 bits), so
+ *  instead the addresses that symbols are actually at are kept in a hash
+ *  table that grows with the symbols. Either way
+ *  <code>symbol_find_by_addr()</code> takes constant time (expected time, for
+ *  the hash table).
+ *  <p>
+ *  An address is the bit pattern of the <code>int</code> passed as
+ *  <code>addr</code>, taken as unsigned. Symbols whose address does not fit in
+ *  <code>addr_bits</code> bits are found by name but not by address, as is
+ *  address 0xFFFFFFFF, which is <code>SYMBOL_NO_ADDR</code>, in a 32 bit
+ *  space.
+ *
+ *  @param table_size - The size of the hash table.
+ *  @param addr_bits - The width of an address, from 1 to 32.
+ *  @return A pointer to the new table, or NULL if <code>addr_bits</code> is
+ *  out of range.
+ */
+sym_table_t* symbol_init_width (int table_size, int addr_bits);
+
+/** An allocator for a table to take its memory from, given to
+ *  <code>symbol_init_ex()</code>. Both functions get the allocator's
+ *  <code>context</code>, so one pair of functions can serve several pools.
+ *  A table in use by several threads at once (see
+ *  <code>symbol_merge()</code> and <code>symbol_iterate_parallel()</code>)
+ *  calls them from each thread, like <code>malloc()</code>.
+ */
+typedef struct symbol_alloc {
+  /** Return <code>bytes</code> bytes aligned to <code>align</code> (a power
+   *  of 2, at most 64), or NULL if there are none */
+  void* (*alloc) (size_t bytes, size_t align, void* context);
+  /** Take back a block from <code>alloc</code>, of the size asked for */
+  void  (*free) (void* ptr, size_t bytes, void* context);
+  void*   context; /**< passed to both functions */
+} symbol_alloc_t;
+
+/** The memory use of a table, as reported by <code>symbol_memory()</code> */
+typedef struct symbol_mem {
+  size_t live;   /**< bytes allocated and not yet freed      */
+  size_t peak;   /**< most bytes ever live at once           */
+  size_t budget; /**< limit on live bytes, 0 if there is none */
+} symbol_mem_t;
+
+/** Create a new symbol table, like <code>symbol_init_width()</code>, that
+ *  takes all its memory from <code>alloc</code> and keeps it within
+ *  <code>budget</code> bytes. Everything the table allocates goes through
+ *  <code>alloc</code>, including the copies of its names, the pages of its
+ *  snapshots and the scratch space of <code>symbol_merge()</code>, and is
+ *  counted by <code>symbol_memory()</code>.
+ *  <p>
+ *  A function that adds symbols first makes sure the budget holds the most
+ *  that adding them could allocate, and returns <code>SYMBOL_NOMEM</code>
+ *  without changing the table if it does not (<code>symbol_merge()</code>
+ *  returns -1 and merges nothing). Likewise <code>symbol_snapshot()</code>
+ *  returns NULL, and <code>symbol_bloom()</code> and
+ *  <code>symbol_hot_cache()</code> leave the table without a filter or cache,
+ *  rather than go past the budget. Every other allocation is checked
+ *  against the budget when it is made, and one that does not fit fails as
+ *  if the allocator had (see below): this covers moving a symbol to a new
+ *  address, copying a page still shared with a snapshot before writing to
+ *  it, and scratch space. So the table never holds more than its budget. A
+ *  table and its snapshots share one budget and one account.
+ *  <p>
+ *  Should the allocator itself fail, a function fails without changing what
+ *  the table holds: the functions that add, move or remove symbols return
+ *  <code>SYMBOL_NOMEM</code>, <code>symbol_merge()</code> returns -1, and
+ *  <code>symbol_snapshot()</code> and the functions that create a table
+ *  return NULL. <code>symbol_bloom()</code> and
+ *  <code>symbol_hot_cache()</code> leave the table without a filter or
+ *  cache, and <code>symbol_iterate_parallel()</code> runs on fewer threads.
+ *  Lookups allocate nothing, except the first time a compressed name is
+ *  returned (see <code>symbol_compress_names()</code>).
+ *
+ *  @param table_size - The size of the hash table.
+ *  @param addr_bits - The width of an address, from 1 to 32.
+ *  @param alloc - The allocator to use, which is copied, or NULL for
+ *  <code>malloc()</code> and <code>free()</code>.
+ *  @param budget - The most bytes the table may hold at once, or 0 for no
+ *  limit.
+ *  @return A pointer to the new table, or NULL if <code>addr_bits</code> is
+ *  out of range, the empty table does not fit in the budget or the allocator
+ *  failed.
+ */
+sym_table_t* symbol_init_ex (int table_size, int addr_bits, const symbol_alloc_t* alloc,
+                             size_t budget);
+
+/** Report how much memory a table (together with its snapshots) holds now,
+ *  the most it has held, and its budget. A table in shared memory reports
+ *  only what the calling process allocated to use it.
+ *
+ *  @param symTab - Pointer to a sym_table_t structure.
+ *  @param mem - Set to the table's memory use.
+ */
+void symbol_memory (sym_table_t* symTab, symbol_mem_t* mem);
+
 /** Add a symbol to the symbol table. This function assumes that the name you
  *  are trying to add to the symbol table is not already associated with  an
  *  existing symbol (you do not have to check for name duplicates in this
@@ -188,18 +337,19 @@ sym_table_t* symbol_init (int table_size);
  *      you may see repeated symbols in the program output. Type <code>man
  *      strdup</code> in the terminal to see the documentation for this
  *      function.<br /><br /></li>
- *  <li>If you don't add the new node to the beginning of the linked list,
- *      the output that your <code>symbol_iterate()</code> function generates
- *      when using the <code>list</code> command may be different from what the
- *      autograder expects and you may not get full credit.</li>
+ *  <li>Adding the new node to the beginning of the linked list means the
+ *      most recently added of several symbols at the same index is found
+ *      first.</li>
  *  </ol>
  * 
  *  @param symTab - Pointer to a sym_table_t structure so that you can access
  *  the hash table and the address table.
  *  @param name - The name of the symbol.
  *  @param addr - The address of the symbol.
+ *  @return 1 if the symbol was added, <code>SYMBOL_NOMEM</code> if there was
+ *  no room for it.
  */
-void symbol_add_unique (sym_table_t* symTab, const char* name, int addr);
+int symbol_add_unique (sym_table_t* symTab, const char* name, int addr);
 
 /** Search for a symbol's name given its address. This should be a simple lookup
  *  in the <code>addr_table</code>. Use the <code>label</code> command to test
@@ -239,14 +389,13 @@ char* symbol_find_by_addr (sym_table_t* symTab, int addr);
  *  event-driven programming where callback functions are needed to process
  *  events. This is a popular paradigm in computer networking.
  * 
- *  It is <span style="color: red; font-weight: bold;">very important</span>
- *  that you visit the nodes in a specific order. You must have a loop that
- *  visits each entry in the hash table starting at index 0. Every time it finds
- *  a non-NULL pointer, it must traverse the corresponding linked list. The
- *  following figure shows a hash table of size 6. The order of traversal is
- *  shown with numbers inside each node:
- * 
- *  <img summary="traversal" src="symbol_iterate_order.png">
+ *  Symbols are visited in the order in which they were added, so a listing
+ *  comes out in source order without sorting, and a symbol added after a
+ *  <code>symbol_remove()</code> comes after every symbol added before it.
+ *  The table keeps an array of its symbols in that order, in which removed
+ *  symbols leave gaps that are closed up before they outnumber the symbols,
+ *  so the cost of a visit depends only on the number of symbols, not on the
+ *  size of the hash table.
  * 
  *  @param symTab - Pointer to a sym_table_t structure so that you can access
  *  the hash table and the address table.
@@ -257,6 +406,87 @@ char* symbol_find_by_addr (sym_table_t* symTab, int addr);
  */
 void symbol_iterate (sym_table_t* symTab, iterate_fnc_t fnc, void* data);
 
+/** Start a cursor at the first symbol of a table. Together with
+ *  <code>symbol_iter_next()</code> this is an alternative to
+ *  <code>symbol_iterate()</code> in which the caller owns the loop, so it can
+ *  stop early, or keep the cursor and resume later. Symbols are returned in
+ *  the order they were added, as by <code>symbol_iterate()</code>. The cursor
+ *  is valid only as long as the table is not modified.
+ *
+ *  @param symTab - Pointer to a sym_table_t structure.
+ *  @param iter - The cursor to initialize.
+ */
+void symbol_iter_begin (sym_table_t* symTab, symbol_iter_t* iter);
+
+/** Start a cursor over one part of a table. The table is split into
+ *  <code>nparts</code> runs of consecutive symbols of about equal size; the cursors of parts
+ *  <code>0 .. nparts-1</code> together visit every symbol exactly once, so
+ *  each part can be given to a different thread.
+ *
+ *  @param symTab - Pointer to a sym_table_t structure.
+ *  @param iter - The cursor to initialize.
+ *  @param part - Which part to visit, from 0 to <code>nparts - 1</code>.
+ *  @param nparts - The number of parts the table is split into.
+ */
+void symbol_iter_part (sym_table_t* symTab, symbol_iter_t* iter, int part, int nparts);
+
+/** Advance a cursor.
+ *
+ *  @param iter - A cursor initialized by <code>symbol_iter_begin()</code> or
+ *  <code>symbol_iter_part()</code>.
+ *  @return The next symbol, or NULL when the cursor has visited all of its
+ *  symbols.
+ */
+symbol_t* symbol_iter_next (symbol_iter_t* iter);
+
+/** Visit all the symbols in the table using several threads. The table is
+ *  split into <code>nthreads</code> parts as by <code>symbol_iter_part()</code>,
+ *  and the symbols of part <code>i</code> are passed to <code>fnc</code>
+ *  together with <code>data[i]</code>. Each thread thus accumulates its own
+ *  result without locking, and when the function returns the caller combines
+ *  <code>data[0]</code> through <code>data[n-1]</code>, where <code>n</code>
+ *  is the return value. The calling thread works on part 0 itself. The table
+ *  must not be modified while this function runs.
+ *
+ *  @param symTab - Pointer to a sym_table_t structure.
+ *  @param nthreads - The number of parts (and threads) to use.
+ *  @param fnc - Pointer to the function to be called on every symbol. It is
+ *  called concurrently from different threads.
+ *  @param data - Array of at least <code>nthreads</code> per-thread arguments.
+ *  @return The number of parts actually used, which is less than
+ *  <code>nthreads</code> if the table is too small to split that many ways.
+ */
+int symbol_iterate_parallel (sym_table_t* symTab, int nthreads, iterate_fnc_t fnc, void* data[]);
+
+/** Add the symbols of several tables to one table, as if by calling
+ *  <code>symbol_add()</code> for each symbol of <code>srcs[0]</code>, then of
+ *  <code>srcs[1]</code>, and so on, but using several threads. The work is
+ *  split by hash table index of <code>dst</code>: each thread adds exactly the
+ *  symbols that hash into its range of indices, so the threads never write
+ *  the same list. Space for all the source symbols is reserved in
+ *  <code>dst</code> before the threads start.
+ *  <p>
+ *  A symbol whose name is already defined (in <code>dst</code>, or in an
+ *  earlier source table) is not added. Once all threads are done,
+ *  <code>conflict</code> is called for every such duplicate, in source order,
+ *  from the calling thread. The merged symbols keep their source order in
+ *  <code>dst</code>. The source tables are not modified, and must not be
+ *  <code>dst</code> itself.
+ *
+ *  @param dst - The table to add symbols to.
+ *  @param srcs - The tables to add symbols from.
+ *  @param n - The number of tables in <code>srcs</code>.
+ *  @param nthreads - The number of threads to use.
+ *  @param conflict - Function to call for each duplicate definition, or NULL.
+ *  @param data - Passed on to <code>conflict</code>.
+ *  @return The number of duplicate definitions found, or -1 if any of the
+ *  tables is in shared memory, the merged symbols might not fit in the
+ *  memory budget of <code>dst</code> (see <code>symbol_init_ex()</code>) or
+ *  the allocator failed, in which case nothing is merged.
+ */
+int symbol_merge (sym_table_t* dst, sym_table_t* srcs[], int n, int nthreads,
+                  conflict_fnc_t conflict, void* data);
+
 /** This function is a useful support function for the
  *  <code>symbol_add()</code> and <code>symbol_find_by_name()</code> functions.
  *  It searches for a node in the hash table whose symbol's name matches the
@@ -324,7 +554,8 @@ struct node* symbol_search (sym_table_t* symTab, const char* name, int* ptrToHas
  *  @param name - The name of the symbol.
  *  @param addr - The address of the symbol.
  *  @return 1 if the symbol is not a name duplicate and was added, 0 if the
- *  symbol is a name duplicate.
+ *  symbol is a name duplicate, <code>SYMBOL_NOMEM</code> if there was no room
+ *  for it.
  */
 int symbol_add (sym_table_t* symTab, const char* name, int addr);
 
@@ -338,6 +569,212 @@ int symbol_add (sym_table_t* symTab, const char* name, int addr);
  */
 symbol_t* symbol_find_by_name (sym_table_t* symTab, const char* name);
 
+/** Change the address of an existing symbol. The search for the name is case
+ *  insensitive, as in <code>symbol_find_by_name()</code>. The address table
+ *  is kept consistent: if the symbol was the one named at its old address,
+ *  that entry passes to the next oldest symbol at the same address (or
+ *  becomes empty), and the symbol is named at its new address if no other
+ *  symbol is already.
+ *
+ *  @param symTab - Pointer to a sym_table_t structure.
+ *  @param name - The name of the symbol.
+ *  @param addr - The new address of the symbol.
+ *  @return 1 if the symbol was found and updated, 0 if there is no symbol
+ *  with that name, or <code>SYMBOL_NOMEM</code> if there was no memory for
+ *  the move and the symbol was left where it was.
+ */
+int symbol_update (sym_table_t* symTab, const char* name, int addr);
+
+/** Return the id of a symbol, adding it with address
+ *  <code>SYMBOL_NO_ADDR</code> if it is not in the table yet. The id is a
+ *  small non-negative integer (ids are dense, starting at 0) that identifies
+ *  the symbol until it is removed or the table is reset, and stays valid in
+ *  snapshots of the table. A front end can intern each identifier once and
+ *  from then on use <code>symbol_name()</code>, <code>symbol_get_addr()</code>
+ *  and <code>symbol_set_addr()</code>, which index an array directly instead
+ *  of hashing and comparing the name.
+ *
+ *  @param symTab - Pointer to a sym_table_t structure.
+ *  @param name - The name of the symbol (case insensitive, as in
+ *  <code>symbol_find_by_name()</code>).
+ *  @return The id of the symbol, or <code>SYMBOL_NOMEM</code> if it had to be
+ *  added and there was no room for it.
+ */
+int symbol_intern (sym_table_t* symTab, const char* name);
+
+/** Return the name of an interned symbol.
+ *
+ *  @param symTab - Pointer to a sym_table_t structure.
+ *  @param id - An id returned by <code>symbol_intern()</code>.
+ *  @return The symbol's name, or NULL if <code>id</code> is not the id of a
+ *  symbol in the table.
+ */
+char* symbol_name (sym_table_t* symTab, int id);
+
+/** Return the address of an interned symbol.
+ *
+ *  @param symTab - Pointer to a sym_table_t structure.
+ *  @param id - An id returned by <code>symbol_intern()</code>.
+ *  @return The symbol's address, or <code>SYMBOL_NO_ADDR</code> if it has
+ *  none or <code>id</code> is not the id of a symbol in the table.
+ */
+int symbol_get_addr (sym_table_t* symTab, int id);
+
+/** Set the address of an interned symbol. This is the same as
+ *  <code>symbol_update()</code> but skips the name lookup.
+ *
+ *  @param symTab - Pointer to a sym_table_t structure.
+ *  @param id - An id returned by <code>symbol_intern()</code>.
+ *  @param addr - The new address of the symbol.
+ *  @return 1 on success, 0 if <code>id</code> is not the id of a symbol in
+ *  the table, or <code>SYMBOL_NOMEM</code> if there was no memory for the
+ *  move.
+ */
+int symbol_set_addr (sym_table_t* symTab, int id, int addr);
+
+/** Remove one symbol from the symbol table. The search for the name is case
+ *  insensitive, as in <code>symbol_find_by_name()</code>. The symbol is
+ *  unlinked from its hash chain and its name is freed; nothing is left behind
+ *  in the chain, so lookups cost the same however many symbols have been
+ *  removed. If the symbol was the one named in the address table, the entry
+ *  passes to the next oldest symbol at the same address (or becomes empty).
+ *  <p>
+ *  The storage of the symbol is reused by the next symbol added, but the
+ *  new symbol still comes last in iteration order. Any
+ *  <code>symbol_t</code> pointer to the removed symbol becomes invalid.
+ *
+ *  @param symTab - Pointer to a sym_table_t structure.
+ *  @param name - The name of the symbol.
+ *  @return 1 if the symbol was removed, 0 if there is no symbol with that
+ *  name, or <code>SYMBOL_NOMEM</code> if there was no memory to unlink it
+ *  and the symbol was kept.
+ */
+int symbol_remove (sym_table_t* symTab, const char* name);
+
+/** Give a table a Bloom filter of its names, or remove it. The filter is a
+ *  compact bit array that answers "definitely not in the table" for most
+ *  names that are not, by testing a few bits in a single 64 byte block. With
+ *  a filter, a lookup of a missing name usually costs one memory access
+ *  instead of a hash table entry plus a list. A lookup of a name that is
+ *  present costs one access more than without a filter, so it pays off for
+ *  tables that are mostly probed for names they do not define, as in
+ *  <code>symbol_find_in_tables()</code>.
+ *  <p>
+ *  The filter grows with the table. Removed symbols stay in the filter until
+ *  the next reset, or until the filter is rebuilt for growth.
+ *
+ *  @param symTab - Pointer to a sym_table_t structure.
+ *  @param bits_per_symbol - Size of the filter in bits per symbol; 10 gives
+ *  about 1% false positives. Zero or less removes the filter.
+ */
+void symbol_bloom (sym_table_t* symTab, int bits_per_symbol);
+
+/** Turn compressed storage of long names on or off for the symbols added to
+ *  a table from now on. A name too long to be kept in the symbol's node is
+ *  normally copied with <code>strdup()</code>. With compression on, it is
+ *  appended instead to a name store that the table keeps in pages, coded as
+ *  the length of the prefix it shares with the name added before it followed
+ *  by the rest. Generated names with long common prefixes then take a few
+ *  bytes each instead of a heap block each. Names are coded in blocks of 16,
+ *  the first of which is stored whole, so a name is never more than 15
+ *  steps from one that can be read directly, and
+ *  <code>symbol_find_by_name()</code> compares a name to a stored one without
+ *  decoding it, skipping the entries of the block that cannot match.
+ *  <p>
+ *  The name store only grows: the space of a removed name is reclaimed by
+ *  <code>symbol_reset()</code>, not by <code>symbol_remove()</code>. Names of
+ *  255 characters or more are always copied, and a table in shared memory
+ *  ignores this function.
+ *  <p>
+ *  A symbol whose name is in the store has no copy of its name until one is
+ *  needed: the first function to return the symbol or its name decodes the
+ *  name into a copy that the symbol keeps until it is removed. So the
+ *  symbol and name returned are the table's own and last as long as they
+ *  would without compression, and only the names that are returned take a
+ *  heap block. Should there be no memory for the copy, a lookup returns
+ *  NULL and an iteration skips the symbol. <code>symbol_merge()</code> into
+ *  a table with compression on uses only the calling thread.
+ *
+ *  @param symTab - Pointer to a sym_table_t structure.
+ *  @param enable - 1 to compress the names of new symbols, 0 to copy them.
+ */
+void symbol_compress_names (sym_table_t* symTab, int enable);
+
+/** Give a table a cache of the symbols found most recently by name, or
+ *  remove it. In most programs a few labels account for most lookups, but a
+ *  symbol's place in its hash table list is fixed by when it was added, so a
+ *  popular one may sit behind several others. The cache is a small array
+ *  indexed by hash value that remembers symbols found down their lists;
+ *  <code>symbol_find_by_name()</code> checks it when the head of a list
+ *  does not match, and a hit costs one comparison of names and no further
+ *  list. Each slot counts its hits, and a symbol only takes a slot from
+ *  another once the lookups of others have worn its count down, so a burst
+ *  of lookups of rarely used names does not flush the popular ones. Lookups
+ *  that end at the head of a list, or in a list of one, never touch the
+ *  cache; the others cost one extra memory access on a miss, to a cache
+ *  small enough to stay near the processor. The cache pays off when lookups
+ *  are concentrated on few symbols and lists are long: with 100000 symbols
+ *  in 12500 lists, a 1024 slot cache makes Zipf distributed lookups 10 to
+ *  15% faster. Lookups spread evenly over a large table rarely hit, and the
+ *  cache keeps score: once misses have outweighed hits for a while, only one
+ *  lookup in 64 probes it, until it hits often enough to pay again. Such
+ *  lookups then run within about 2% of their speed without a cache.
+ *  <p>
+ *  The cache holds hints, not answers: a cached symbol is compared with the
+ *  name looked up like any other, so removing symbols and resetting the table
+ *  need not touch it. It belongs to the handle, not the table it refers to:
+ *  a snapshot gets an empty cache of the same size, and a process using a
+ *  table in shared memory has its own.
+ *
+ *  @param symTab - Pointer to a sym_table_t structure.
+ *  @param slots - Number of cache slots, rounded up to a power of 2 of at
+ *  most 65536; 1024 slots take 8 KB and cover the hot labels of most
+ *  programs. Zero or less removes the cache.
+ */
+void symbol_hot_cache (sym_table_t* symTab, int slots);
+
+/** Find a symbol in the first of several tables that defines it, as a linker
+ *  resolves an external reference against a list of modules. The name is
+ *  hashed once, and the Bloom filters of all the tables are tested before
+ *  any hash table list is searched, so tables with a filter that rules the
+ *  name out cost a single memory access. Tables without a filter are always
+ *  searched.
+ *
+ *  @param tabs - The tables to search, in order.
+ *  @param n - The number of tables.
+ *  @param name - The name of the symbol (case insensitive).
+ *  @param which - If not NULL, set to the index of the table the symbol was
+ *  found in (unchanged if it was not found).
+ *  @return A pointer to the symbol or NULL if no table defines it.
+ */
+symbol_t* symbol_find_in_tables (sym_table_t* tabs[], int n, const char* name, int* which);
+
+/** Create a logical copy of a symbol table. The copy shares all of its storage
+ *  with <code>symTab</code>, so taking a snapshot costs one pointer copy per
+ *  page of the table rather than one <code>symbol_add()</code> per symbol.
+ *  Afterwards the two tables are completely independent: adding, updating or
+ *  resetting symbols in either one is never visible in the other. The first
+ *  write to a shared page gives the writing table its own copy of that page;
+ *  all other pages stay shared.
+ *  <p>
+ *  A snapshot is an ordinary table. It may itself be snapshotted, and must be
+ *  released with <code>symbol_term()</code>, which frees only the pages no
+ *  other table still uses. Parent and snapshot may be terminated in either
+ *  order, and tables that share pages may be used from different threads at
+ *  once, since each keeps count of its pages' users atomically. Taking a
+ *  snapshot reads <code>symTab</code>, so it must not overlap a write to it.
+ *  <p>
+ *  A <code>symbol_t</code> pointer obtained from either table before a write
+ *  may refer to the storage the other table keeps, so look symbols up again
+ *  after modifying a table that has live snapshots.
+ *
+ *  @param symTab - Pointer to the sym_table_t structure to copy.
+ *  @return A pointer to the new table, or NULL if <code>symTab</code> is in
+ *  shared memory, the snapshot does not fit in its memory budget or the
+ *  allocator failed.
+ */
+sym_table_t* symbol_snapshot (sym_table_t* symTab);
+
 /** Remove all the symbols from the symbol table. This involves:
  * 
  *  <ul>
@@ -356,6 +793,15 @@ symbol_t* symbol_find_by_name (sym_table_t* symTab, const char* name);
  *  some blocks in the heap. You can wait until you implement
  *  <code>symbol_term()</code> to check for memory leaks. Refer to the main
  *  instructions for details on how to run Valgrind.
+ *  <p>
+ *  In this implementation a reset takes the same short time however many
+ *  symbols the table holds. Instead of clearing the hash table, the nodes and
+ *  the address table, it starts a new generation of the table, in which
+ *  storage written before the reset reads as empty. That storage is kept and
+ *  reclaimed a page at a time as symbols are added again, so a table that is
+ *  refilled after each reset allocates nothing new. A page that a snapshot
+ *  still uses is left to the snapshot rather than reclaimed.
+ *  <code>symbol_term()</code> frees whatever has not been reused.
  * 
  *  @param symTab - Pointer to a sym_table_t structure so that you can access
  *  the hash table and the address table.
@@ -383,5 +829,66 @@ void symbol_reset (sym_table_t* symTab);
  */
 void symbol_term(sym_table_t* symTab);
 
+/** Create a symbol table in a named POSIX shared memory object, so that other
+ *  processes can use it with <code>symbol_shm_attach()</code>. Such a table
+ *  holds no pointers: its nodes, names, hash table and address table refer
+ *  to each other by offsets within the object, which every process may map at
+ *  a different address. The object is sized when it is created, for at most
+ *  <code>max_symbols</code> symbols whose long names average no more than 32
+ *  characters; adding beyond that returns <code>SYMBOL_NOMEM</code>. The
+ *  space of a long name is given back by <code>symbol_remove()</code> and
+ *  reused for the next long name of about the same length, so adding and
+ *  removing symbols does not use it up. Pages
+ *  are still only touched when first written, but each handle allocates its
+ *  process's copies of every symbol up front, so that lookups never allocate.
+ *  Addresses are 16 bits wide, as
+ *  with <code>symbol_init()</code>.
+ *  <p>
+ *  Any number of processes may use the table at once. Every function takes a
+ *  readers/writer lock that lives in the object, so lookups in different
+ *  processes run concurrently, and a function that modifies the table excludes
+ *  all others. The intended use is one writer that populates the table while
+ *  any number of readers call <code>symbol_find_by_name()</code> and
+ *  <code>symbol_find_by_addr()</code>, which return names that point directly
+ *  into the shared object. The <code>symbol_t</code> a lookup returns is a
+ *  copy private to the calling process, and is overwritten when the same
+ *  symbol is looked up again. A cursor (<code>symbol_iter_begin()</code>) does
+ *  not hold the lock between calls, so it is only reliable while no other
+ *  process writes.
+ *  <p>
+ *  A table in shared memory cannot have a Bloom filter
+ *  (<code>symbol_bloom()</code> does nothing), be snapshotted, or take part in
+ *  <code>symbol_merge()</code>. <code>symbol_term()</code> unmaps the object
+ *  but leaves the table in it for other processes; remove the object with
+ *  <code>symbol_shm_unlink()</code>. A handle may be used by one thread at a
+ *  time.
+ *
+ *  @param name - The name of the shared memory object, such as
+ *  <code>"/lc3syms"</code>. It must not exist yet.
+ *  @param table_size - The size of the hash table.
+ *  @param max_symbols - The largest number of symbols the table can hold.
+ *  @return A pointer to the table, or NULL if the object could not be
+ *  created or there was no memory for the handle.
+ */
+sym_table_t* symbol_shm_create (const char* name, int table_size, int max_symbols);
+
+/** Use a table created by another process with
+ *  <code>symbol_shm_create()</code>.
+ *
+ *  @param name - The name of the shared memory object.
+ *  @return A pointer to the table, or NULL if there is no such object or it
+ *  does not hold a symbol table.
+ */
+sym_table_t* symbol_shm_attach (const char* name);
+
+/** Remove the name of a shared memory object holding a table. Processes that
+ *  are attached keep using the table until they call
+ *  <code>symbol_term()</code>.
+ *
+ *  @param name - The name of the shared memory object.
+ *  @return 1 on success, 0 if there is no such object.
+ */
+int symbol_shm_unlink (const char* name);
+
 #endif /* __SYMBOL_H__ */
 
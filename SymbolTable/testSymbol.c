@@ -50,32 +50,64 @@
 /** Maximum length of command line processed */
 #define MAX_LINE_LENGTH 128
 
+/** Maximum number of nested snapshots */
+#define MAX_SNAPSHOTS 16
+
 /** Delimiter used separate tokens on line - used by strtok() */
 const char *delim = " \t";
 
 /** Print a usage statement describing how program is used */
 static void help() {
   puts("");
-  puts("Usage: testSymbol [-debug] <size>\n");
+  puts("Usage: testSymbol [-debug] <size> [bits [budget]]\n");
   puts("The <size> argument corresponds to the table_size parameter in the");
-  puts("symbol_init function. Enter commands from keyboard, one per line:");
+  puts("symbol_init function, the optional [bits] argument to the addr_bits");
+  puts("parameter of symbol_init_width (the default is 16), and the optional");
+  puts("[budget] argument to the budget parameter of symbol_init_ex, in bytes");
+  puts("(the default, 0, is no limit). Enter commands from keyboard, one per");
+  puts("line:");
   puts("");
   puts("quit/exit         - terminates program");
   puts("                    (calls symbol_term)");
   puts("");
-  puts("add name address  - prints OK on success, Duplicate on failure");
+  puts("add name address  - prints OK on success, Duplicate or Full on failure");
   puts("                    (calls symbol_add)");
   puts("");
-  puts("addu name address - prints OK");
+  puts("addu name address - prints OK, or Full on failure");
   puts("                    (calls symbol_add_unique)");
   puts("");
+  puts("bloom bits        - give the table a Bloom filter of bits per symbol,");
+  puts("                    or remove it with 0");
+  puts("                    (calls symbol_bloom)");
+  puts("");
+  puts("cache slots       - remember recent lookups by name in a cache");
+  puts("                    (calls symbol_hot_cache)");
+  puts("");
+  puts("compress 0|1      - store the long names of new symbols compressed");
+  puts("                    (calls symbol_compress_names)");
+  puts("");
   puts("count             - prints count of names/addresses");
   puts("                    uses function pointers");
   puts("                    (calls symbol_iterate)");
   puts("");
+  puts("pcount threads    - prints count of names/addresses");
+  puts("                    counting in parallel with the given threads");
+  puts("                    (calls symbol_iterate_parallel)");
+  puts("");
+  puts("find name         - prints NULL or the snapshot depth and name/address");
+  puts("                    of the first of the current table and the tables");
+  puts("                    it was snapped from, newest first, to define name");
+  puts("                    (calls symbol_find_in_tables)");
+  puts("");
   puts("get name          - prints NULL or name/address");
   puts("                    (calls symbol_find_by_name)");
   puts("");
+  puts("intern name       - prints the id of name, adding it if needed");
+  puts("                    (calls symbol_intern)");
+  puts("");
+  puts("id number         - prints NULL or name/address of the symbol with id");
+  puts("                    (calls symbol_name and symbol_get_addr)");
+  puts("");
   puts("label address     - prints NULL or name associated with address");
   puts("                    (calls symbol_find_by_addr)");
   puts("");
@@ -83,12 +115,43 @@ static void help() {
   puts("                    uses function pointers");
   puts("                    (calls symbol_iterate)");
   puts("");
+  puts("merge threads     - add the symbols of the tables the current one was");
+  puts("                    snapped from, oldest first, with the given threads;");
+  puts("                    prints each duplicate, then their count or NULL");
+  puts("                    (calls symbol_merge)");
+  puts("");
+  puts("memory            - prints bytes live, peak bytes and the budget");
+  puts("                    (calls symbol_memory)");
+  puts("");
   puts("search name       - prints NULL or name/address and hash/index");
   puts("                    (calls symbol_search)");
   puts("");
+  puts("move name address - prints OK, or NULL if there is no such name");
+  puts("                    (calls symbol_update)");
+  puts("");
+  puts("remove name       - prints OK, or NULL if there is no such name");
+  puts("                    (calls symbol_remove)");
+  puts("");
   puts("reset             - resets symbol table and address table");
   puts("                    (calls symbol_reset)");
   puts("");
+  puts("snap              - continue with a snapshot of the current table");
+  puts("                    (calls symbol_snapshot)");
+  puts("");
+  puts("drop              - discard the current snapshot, return to its parent");
+  puts("                    (calls symbol_term)");
+  puts("");
+  puts("share object max  - continue with a new table of up to max symbols in");
+  puts("                    shared memory object (e.g. /syms), drop returns");
+  puts("                    (calls symbol_shm_create)");
+  puts("");
+  puts("attach object     - continue with the table in shared memory object");
+  puts("                    that another process shared, drop returns");
+  puts("                    (calls symbol_shm_attach)");
+  puts("");
+  puts("unlink object     - remove shared memory object, prints OK or NULL");
+  puts("                    (calls symbol_shm_unlink)");
+  puts("");
 }
 
 /** Print a usage statement describing how program is used, and exits */
@@ -123,6 +186,9 @@ static void countSymbols (symbol_t* sym, void *data) {
   *ip = *ip + 1;
 }
 
+/** Maximum number of threads used by the pcount command */
+#define MAX_THREADS 64
+
 /** Another example of a call back function called via symbol_iterate()
  */
 static void printResult(symbol_t* sym, void* data) {
@@ -134,6 +200,15 @@ static void printResult(symbol_t* sym, void* data) {
     fprintf(f, "name:%s addr:%d\n", sym->name, sym->addr);
 }
 
+/** Call back function called via symbol_merge() for each duplicate
+ */
+static void printConflict (symbol_t* existing, symbol_t* duplicate, int src, void* data) {
+  FILE* f = (FILE*) data;
+
+  fprintf(f, "duplicate name:%s addr:%d from table %d, kept addr:%d\n",
+          duplicate->name, duplicate->addr, src, existing->addr);
+}
+
 /** Entry point of the program
  * @param argc count of arguments, will always be at least 1
  * @param argv array of parameters to program argv[0] is the name of
@@ -145,13 +220,23 @@ int main (int argc, const char* argv[]) {
   int  count, addr;
   char *cmd, *name;
   sym_table_t* symTab;
+  sym_table_t* parents[MAX_SNAPSHOTS];
+  int          depth = 0;
 
   debugInit(&argc, argv);
   
   if (argc < 2)
     usage();
 
-  symTab = symbol_init(atoi(argv[1]));
+  if (argc > 3)
+    symTab = symbol_init_ex(atoi(argv[1]), atoi(argv[2]), NULL, strtoul(argv[3], NULL, 0));
+  else if (argc > 2)
+    symTab = symbol_init_width(atoi(argv[1]), atoi(argv[2]));
+  else
+    symTab = symbol_init(atoi(argv[1]));
+
+  if (! symTab)
+    usage();
 
   while (fgets(line, sizeof(line), stdin) != NULL) {
     char *cr = strchr(line ,'\n'); /* get rid of trailing \n, if any */
@@ -167,21 +252,68 @@ int main (int argc, const char* argv[]) {
     if (strcmp(cmd, "add") == 0) {
       name = nextToken();
       addr = nextInt();
-      fprintf(stderr, "%s\n", (symbol_add(symTab, name, addr) ? "OK" : "Duplicate"));
+      count = symbol_add(symTab, name, addr);
+      fprintf(stderr, "%s\n", (count == SYMBOL_NOMEM) ? "Full" : (count ? "OK" : "Duplicate"));
     } else if (strcmp(cmd, "addu") == 0) {
       name = nextToken();
       addr = nextInt();
-      symbol_add_unique(symTab, name, addr);
-      fprintf(stderr, "OK\n");
+      count = symbol_add_unique(symTab, name, addr);
+      fprintf(stderr, "%s\n", (count == SYMBOL_NOMEM) ? "Full" : "OK");
+    }
+    else if (strcmp(cmd, "bloom") == 0) {
+      symbol_bloom(symTab, nextInt());
+    }
+    else if (strcmp(cmd, "cache") == 0) {
+      symbol_hot_cache(symTab, nextInt());
+    }
+    else if (strcmp(cmd, "compress") == 0) {
+      symbol_compress_names(symTab, nextInt());
     }
     else if (strcmp(cmd, "count") == 0) {
       count = 0;
       symbol_iterate(symTab, countSymbols, &count);
       fprintf(stderr, "symbol count: %d\n", count);
     }
+    else if (strcmp(cmd, "pcount") == 0) {
+      int   nthreads = nextInt();
+      int   counts[MAX_THREADS] = { 0 };
+      void* data[MAX_THREADS];
+
+      if (nthreads > MAX_THREADS)
+        nthreads = MAX_THREADS;
+
+      for (int i = 0; i < MAX_THREADS; i++)
+        data[i] = &counts[i];
+
+      nthreads = symbol_iterate_parallel(symTab, nthreads, countSymbols, data);
+      count    = 0;
+
+      for (int i = 0; i < nthreads; i++)
+        count += counts[i];
+
+      fprintf(stderr, "symbol count: %d (%d threads)\n", count, nthreads);
+    }
     else if ((strcmp(cmd, "exit") == 0) || (strcmp(cmd, "quit") == 0)) {
       break;
     }
+    else if (strcmp(cmd, "find") == 0) {
+      sym_table_t* tabs[MAX_SNAPSHOTS + 1];
+      symbol_t*    sym;
+      int          which = 0;
+
+      name    = nextToken();
+      tabs[0] = symTab;
+
+      for (int i = 0; i < depth; i++)
+        tabs[i + 1] = parents[depth - 1 - i];
+
+      sym = symbol_find_in_tables(tabs, depth + 1, name, &which);
+
+      if (sym)
+        printf("depth %d ", depth - which);
+
+      printResult(sym, stdout);
+    }
     else if (strcmp(cmd, "get") == 0) {
       name = nextToken();
       printResult(symbol_find_by_name(symTab, name), stdout);
@@ -189,6 +321,15 @@ int main (int argc, const char* argv[]) {
     else if (strcmp(cmd, "help") == 0) {
       help();
     }
+    else if (strcmp(cmd, "intern") == 0) {
+      name = nextToken();
+      fprintf(stderr, "id: %d\n", symbol_intern(symTab, name));
+    }
+    else if (strcmp(cmd, "id") == 0) {
+      int id = nextInt();
+      symbol_t sym = { symbol_name(symTab, id), symbol_get_addr(symTab, id) };
+      printResult(sym.name ? &sym : NULL, stdout);
+    }
     else if (strcmp(cmd, "label") == 0) {
       addr = nextInt();
       fprintf(stderr, "label at addr %d '%s'\n", addr,
@@ -197,6 +338,75 @@ int main (int argc, const char* argv[]) {
     else if (strcmp(cmd, "list") == 0) {
       symbol_iterate(symTab, printResult, stdout);
     }
+    else if (strcmp(cmd, "memory") == 0) {
+      symbol_mem_t mem;
+      symbol_memory(symTab, &mem);
+      fprintf(stderr, "live: %zu peak: %zu budget: %zu\n", mem.live, mem.peak, mem.budget);
+    }
+    else if (strcmp(cmd, "merge") == 0) {
+      int nthreads = nextInt();
+
+      if (depth == 0) {
+        fprintf(stderr, "no snapshot to merge\n");
+        continue;
+      }
+
+      count = symbol_merge(symTab, parents, depth, nthreads, printConflict, stdout);
+
+      if (count < 0)
+        fprintf(stderr, "NULL\n");
+      else
+        fprintf(stderr, "duplicates: %d\n", count);
+    }
+    else if (strcmp(cmd, "move") == 0) {
+      name = nextToken();
+      addr = nextInt();
+      count = symbol_update(symTab, name, addr);
+      fprintf(stderr, "%s\n", (count == SYMBOL_NOMEM) ? "Full" : (count ? "OK" : "NULL"));
+    }
+    else if (strcmp(cmd, "snap") == 0 || strcmp(cmd, "share") == 0 ||
+             strcmp(cmd, "attach") == 0) {
+      sym_table_t* next;
+
+      if (depth == MAX_SNAPSHOTS) {
+        fprintf(stderr, "too many snapshots\n");
+        continue;
+      }
+
+      if (strcmp(cmd, "snap") == 0) {
+        next = symbol_snapshot(symTab);
+      } else if (strcmp(cmd, "share") == 0) {
+        name = nextToken();
+        next = symbol_shm_create(name, atoi(argv[1]), nextInt());
+      } else {
+        next = symbol_shm_attach(nextToken());
+      }
+
+      if (next) {
+        parents[depth++] = symTab;
+        symTab = next;
+        fprintf(stderr, "snapshot depth: %d\n", depth);
+      } else {
+        fprintf(stderr, "NULL\n");
+      }
+    }
+    else if (strcmp(cmd, "unlink") == 0) {
+      fprintf(stderr, "%s\n", (symbol_shm_unlink(nextToken()) ? "OK" : "NULL"));
+    }
+    else if (strcmp(cmd, "drop") == 0) {
+      if (depth == 0) {
+        fprintf(stderr, "no snapshot to drop\n");
+      } else {
+        symbol_term(symTab);
+        symTab = parents[--depth];
+        fprintf(stderr, "snapshot depth: %d\n", depth);
+      }
+    }
+    else if (strcmp(cmd, "remove") == 0) {
+      name = nextToken();
+      count = symbol_remove(symTab, name);
+      fprintf(stderr, "%s\n", (count == SYMBOL_NOMEM) ? "Full" : (count ? "OK" : "NULL"));
+    }
     else if (strcmp(cmd, "reset") == 0) {
       symbol_reset(symTab);
     }
@@ -214,5 +424,8 @@ int main (int argc, const char* argv[]) {
 
   symbol_term(symTab); /* can check for memory leaks now */
 
+  while (depth > 0)
+    symbol_term(parents[--depth]);
+
   return 0;
 }